@@ -0,0 +1,977 @@
+// Loopback benchmarks of the network library, written as JSON to track regressions between
+// releases. Each case publishes msgs from Nodes of this process to a peer subscribing to them,
+// which runs on a thread of this process or in a child process:
+//
+//   round_trip  Latency percentiles of Twist and Joystick msgs echoed by the peer, one at a time,
+//               with msg handlers dispatched to the main context, the network thread or an executor
+//   throughput  Uint8Array and Image msgs of 64 KB to 25 MB, published as fast as they are queued,
+//               and the 64 KB and 1 MB msgs again with a window of a single unacknowledged msg
+//   fan_out     64 KB msgs to 1 to 64 subscriber Nodes
+//   endpoints   Twist msgs from 1 to 64 publishers to a single subscriber Node
+//   multicast   1 MB msgs from 1 and 2 publishers to one multicast group, paced so that no
+//               datagram is dropped. Fails unless every msg of every publisher is reassembled.
+//
+// Peers in the same process get msgs without a socket and peers in another process through
+// shared memory, or sockets for msgs larger than a shared memory slot or while all slots are
+// in use. Every address of the host is local, so plain sockets are only measured by those
+// msgs. Each result names the path its msgs took, as told by the bytes written to sockets.
+//
+// Cases other than round trips that are over within MIN_SECONDS run again with more msgs, up
+// to MAX_MSGS of each endpoint. Msgs shared within the process get no megabytes per second.
+//
+// With --count-allocations, peers in another process count the allocations made anywhere in
+// their process per msg received. Receiving throughput msgs should allocate nothing once the
+// first msg came in, while round trips also allocate to echo each msg.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+
+#include <network/Dispatch.h>
+#include <network/Image.h>
+#include <network/MsgStats.h>
+#include <network/NetworkRuntime.h>
+#include <network/Node.h>
+#include <network/msgs/Header_generated.h>
+#include <network/msgs/Joystick_generated.h>
+#include <network/msgs/MsgStamp_generated.h>
+#include <network/msgs/SharedMemorySlot_generated.h>
+#include <network/msgs/Twist_generated.h>
+#include <network/msgs/Uint8Array_generated.h>
+#include <network/msgs/Vector3_generated.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using ContextPtr = std::shared_ptr<asio::io_context>;
+using MsgBuffer = std::shared_ptr<flatbuffers::DetachedBuffer>;
+
+// Counted by operator new of this program, once enabled
+std::atomic<bool> countingAllocations(false);
+std::atomic<uint64_t> allocations(0);
+
+// Queues never drop msgs of the benchmarks
+constexpr size_t MAX_QUEUED_BYTES = std::numeric_limits<size_t>::max() / 2;
+
+constexpr auto READY_TIMEOUT = std::chrono::seconds(10);
+constexpr auto ECHO_TIMEOUT = std::chrono::seconds(5);
+constexpr auto DONE_TIMEOUT = std::chrono::seconds(60);
+constexpr auto PEER_TIMEOUT = std::chrono::seconds(90);
+
+// Peers report the msgs received so far once no msg came for this long
+constexpr auto IDLE_TIMEOUT = std::chrono::seconds(1);
+constexpr auto CONTROL_PERIOD = std::chrono::milliseconds(10);
+
+// Rates are measured over MIN_SECONDS at least, unless that takes more msgs than
+// intra-process subscribers queue before dropping them
+constexpr double MIN_SECONDS = 0.2;
+constexpr unsigned int MAX_MSGS = 1000;
+
+// Msgs written to sockets start with a header and carry the msg or its shared memory slot
+constexpr size_t MSG_HEADER_SIZE = sizeof(msgs::Header) + sizeof(msgs::MsgStamp);
+constexpr size_t SHARED_MEMORY_MSG_SIZE = MSG_HEADER_SIZE + sizeof(msgs::SharedMemorySlot);
+
+// Msgs a publisher has in flight to a subscriber by default, as Nodes advertise
+constexpr unsigned int DEFAULT_WINDOW_SIZE = 16;
+
+// Multicast publishers send a msg per period, which the loopback interface keeps up with
+constexpr const char *MULTICAST_GROUP = "239.255.0.1";
+constexpr auto MULTICAST_PERIOD = std::chrono::milliseconds(10);
+
+enum class Benchmark {
+    ROUND_TRIP,
+    THROUGHPUT,
+    FAN_OUT,
+    ENDPOINTS,
+    MULTICAST
+};
+
+enum class Transport {
+    INTRA_PROCESS,
+    INTER_PROCESS,
+    MULTICAST
+};
+
+// Control msgs are Vector3 msgs of a kind and two values: the allocations and the msgs they
+// were counted over, or the msgs received and the seconds no msg came before done
+enum class Control {
+    HELLO,
+    READY,
+    ALLOCATIONS,
+    DONE
+};
+
+struct Case {
+    Benchmark benchmark;
+    Transport transport;
+    std::string payload;
+    ntwk::MsgTypeId msgTypeId;
+    MsgBuffer msg;
+
+    // Where the msgs of round trips are handled, on both ends
+    ntwk::Dispatch::Target dispatch = ntwk::Dispatch::Target::MAIN_CONTEXT;
+
+    // Msgs each publisher sends before waiting for an acknowledgement
+    unsigned int windowSize = DEFAULT_WINDOW_SIZE;
+
+    // Msgs published by each endpoint, after as many warmup msgs
+    unsigned int msgs = 0;
+    unsigned int warmupMsgs = 0;
+    unsigned int subscribers = 1;
+    unsigned int endpoints = 1;
+
+    // The peer publishes on the port and subscribes to the endpoints on the ports after it
+    unsigned short port = 0;
+
+    uint64_t getExpectedMsgs() const {
+        return this->benchmark == Benchmark::ROUND_TRIP ? this->warmupMsgs + this->msgs :
+                uint64_t(this->msgs) * this->subscribers * this->endpoints;
+    }
+
+    // Multicast endpoints all publish to the group on the port after the peer's
+    std::string getUri(unsigned int endpoint) const {
+        if (this->transport == Transport::MULTICAST && endpoint > 0) {
+            return std::string("udp://") + MULTICAST_GROUP + ":" + std::to_string(this->port + 1);
+        }
+        return "tcp://127.0.0.1:" + std::to_string(this->port + endpoint);
+    }
+
+    // A subscriber Node subscribes to each endpoint, or once to the multicast group
+    unsigned int getSubscribedEndpoints() const {
+        return this->transport == Transport::MULTICAST ? 1 : this->endpoints;
+    }
+};
+
+struct Result {
+    ntwk::LatencyHistogram roundTripTime;
+    uint64_t receivedMsgs = 0;
+    double seconds = 0;
+    std::string path;
+    uint64_t socketBytes = 0;
+    bool countedAllocations = false;
+    double allocationsPerMsg = 0;
+    std::string error;
+};
+
+const char *getName(Benchmark benchmark) {
+    switch (benchmark) {
+    case Benchmark::ROUND_TRIP:
+        return "round_trip";
+    case Benchmark::THROUGHPUT:
+        return "throughput";
+    case Benchmark::FAN_OUT:
+        return "fan_out";
+    case Benchmark::ENDPOINTS:
+        return "endpoints";
+    case Benchmark::MULTICAST:
+        return "multicast";
+    }
+    return "";
+}
+
+const char *getName(ntwk::Dispatch::Target dispatch) {
+    switch (dispatch) {
+    case ntwk::Dispatch::Target::MAIN_CONTEXT:
+        return "main_context";
+    case ntwk::Dispatch::Target::NETWORK_THREAD:
+        return "network_thread";
+    case ntwk::Dispatch::Target::EXECUTOR:
+        return "executor";
+    }
+    return "";
+}
+
+// Executors are the context of the Nodes, so that only handlers on the network thread need to
+// hand msgs over to it
+ntwk::Dispatch makeDispatch(ntwk::Dispatch::Target target, asio::io_context &context) {
+    switch (target) {
+    case ntwk::Dispatch::Target::MAIN_CONTEXT:
+        break;
+    case ntwk::Dispatch::Target::NETWORK_THREAD:
+        return ntwk::Dispatch::networkThread();
+    case ntwk::Dispatch::Target::EXECUTOR:
+        return ntwk::Dispatch::onExecutor(context.get_executor());
+    }
+    return ntwk::Dispatch();
+}
+
+const char *getName(Transport transport) {
+    switch (transport) {
+    case Transport::INTRA_PROCESS:
+        return "intra_process";
+    case Transport::INTER_PROCESS:
+        return "inter_process";
+    case Transport::MULTICAST:
+        return "multicast";
+    }
+    return "";
+}
+
+MsgBuffer makeControl(Control control, double first=0, double second=0) {
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(msgs::CreateVector3(builder, static_cast<float>(control), static_cast<float>(first),
+                                       static_cast<float>(second)));
+    return std::make_shared<flatbuffers::DetachedBuffer>(builder.Release());
+}
+
+MsgBuffer makeTwist() {
+    flatbuffers::FlatBufferBuilder builder;
+    const auto linear = msgs::CreateVector3(builder, 1.0f, 0.0f, 0.0f);
+    const auto angular = msgs::CreateVector3(builder, 0.0f, 0.0f, 0.5f);
+    builder.Finish(msgs::CreateTwist(builder, linear, angular));
+    return std::make_shared<flatbuffers::DetachedBuffer>(builder.Release());
+}
+
+MsgBuffer makeJoystick() {
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(msgs::CreateJoystick(builder, 0.25f, -0.75f));
+    return std::make_shared<flatbuffers::DetachedBuffer>(builder.Release());
+}
+
+// Payloads are filled with the same bytes on every run
+std::vector<uint8_t> makeData(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<uint8_t>(i * 31 + (i >> 8));
+    }
+    return data;
+}
+
+MsgBuffer makeUint8Array(size_t size) {
+    const auto data = makeData(size);
+    flatbuffers::FlatBufferBuilder builder(size + 64);
+    builder.Finish(msgs::CreateUint8Array(builder, builder.CreateVector(data)));
+    return std::make_shared<flatbuffers::DetachedBuffer>(builder.Release());
+}
+
+MsgBuffer makeImage(unsigned int width, unsigned int height) {
+    const auto data = makeData(width * height * 3);
+    return ntwk::Image::makeBuffer(width, height, 3, data.data());
+}
+
+// Runs handlers until the condition holds, returning false on timeout
+bool runUntil(asio::io_context &context, Clock::time_point deadline, const std::function<bool()> &condition) {
+    while (!condition()) {
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+        context.run_one_until(deadline);
+    }
+    return true;
+}
+
+// Subscribes to the endpoints of a case with each of its subscriber Nodes, and reports back on
+// its own endpoint: ready once every subscription got a hello from the publishers, then done
+// once it received all msgs or no more msgs came. Round trip msgs are echoed instead.
+class Peer {
+public:
+    Peer(const Case &benchCase, const std::atomic<bool> &stopped) :
+        benchCase(benchCase), stopped(stopped), context(std::make_shared<asio::io_context>()),
+        timer(*this->context) { }
+
+    void run(std::promise<void> *advertised=nullptr);
+
+private:
+    void receiveMsg();
+    void handleMsg();
+    void handleHello(size_t subscription);
+    void handleTimer();
+    void finish();
+
+    const Case &benchCase;
+    const std::atomic<bool> &stopped;
+    ContextPtr context;
+    asio::steady_timer timer;
+    std::unique_ptr<ntwk::Node> replyNode;
+
+    std::vector<bool> greetedSubscriptions;
+    size_t missingHellos = 0;
+    bool started = false;
+    uint64_t receivedMsgs = 0;
+    uint64_t startAllocations = 0;
+    Clock::time_point lastMsgTime;
+    Clock::time_point deadline;
+    bool finished = false;
+};
+
+void Peer::run(std::promise<void> *advertised) {
+    const auto &benchCase = this->benchCase;
+    auto runtime = std::make_shared<ntwk::NetworkRuntime>();
+    this->replyNode = std::make_unique<ntwk::Node>(this->context, runtime);
+    this->replyNode->advertise(benchCase.getUri(0));
+    this->replyNode->setQoS(benchCase.msgTypeId, ntwk::QoS::keepAll(MAX_QUEUED_BYTES));
+    this->replyNode->setQoS(ntwk::MsgTypeId::VECTOR3, ntwk::QoS::keepAll(MAX_QUEUED_BYTES));
+    if (advertised) {
+        advertised->set_value();
+    }
+
+    // Subscribe to the msg type first, so publishers know of it once hellos come through
+    std::vector<std::unique_ptr<ntwk::Node>> nodes;
+    const auto endpoints = benchCase.getSubscribedEndpoints();
+    this->greetedSubscriptions.resize(benchCase.subscribers * endpoints);
+    this->missingHellos = this->greetedSubscriptions.size();
+    for (unsigned int subscriber = 0; subscriber < benchCase.subscribers; ++subscriber) {
+        nodes.emplace_back(std::make_unique<ntwk::Node>(this->context, runtime));
+        for (unsigned int endpoint = 0; endpoint < endpoints; ++endpoint) {
+            const auto uri = benchCase.getUri(endpoint + 1);
+            const auto subscription = subscriber * endpoints + endpoint;
+            nodes.back()->subscribe(uri, benchCase.msgTypeId, [this](ntwk::MsgPtr &&) {
+                this->receiveMsg();
+            }, ntwk::QoS::keepAll(MAX_QUEUED_BYTES), makeDispatch(benchCase.dispatch, *this->context));
+            nodes.back()->subscribe(uri, ntwk::MsgTypeId::VECTOR3, [this, subscription](ntwk::MsgPtr &&) {
+                this->handleHello(subscription);
+            });
+        }
+    }
+
+    this->deadline = Clock::now() + PEER_TIMEOUT;
+    this->handleTimer();
+    auto work = asio::make_work_guard(*this->context);
+    this->context->run();
+
+    // Nodes stop the context when destroyed
+    this->timer.cancel();
+    nodes.clear();
+    this->replyNode.reset();
+}
+
+// Echoes round trip msgs right away, wherever they are handled, and counts msgs on the context
+void Peer::receiveMsg() {
+    if (this->benchCase.benchmark == Benchmark::ROUND_TRIP) {
+        this->replyNode->publish(this->benchCase.msgTypeId, this->benchCase.msg);
+    }
+    if (this->benchCase.dispatch == ntwk::Dispatch::Target::NETWORK_THREAD) {
+        asio::post(*this->context, [this] {
+            this->handleMsg();
+        });
+        return;
+    }
+    this->handleMsg();
+}
+
+void Peer::handleMsg() {
+    if (this->finished) {
+        return;
+    }
+
+    if (!this->started) {
+        this->startAllocations = allocations.load(std::memory_order_relaxed);
+    }
+    this->started = true;
+    this->lastMsgTime = Clock::now();
+    ++this->receivedMsgs;
+    if (this->receivedMsgs == this->benchCase.getExpectedMsgs()) {
+        this->finish();
+    }
+}
+
+void Peer::handleHello(size_t subscription) {
+    if (!this->greetedSubscriptions[subscription]) {
+        this->greetedSubscriptions[subscription] = true;
+        --this->missingHellos;
+    }
+}
+
+void Peer::handleTimer() {
+    const auto now = Clock::now();
+    if (this->finished || this->stopped || now >= this->deadline) {
+        this->context->stop();
+        return;
+    }
+
+    if (!this->started && this->missingHellos == 0) {
+        this->replyNode->publish(ntwk::MsgTypeId::VECTOR3, makeControl(Control::READY));
+    } else if (this->started && now - this->lastMsgTime >= IDLE_TIMEOUT) {
+        this->finish();
+    }
+
+    this->timer.expires_after(CONTROL_PERIOD);
+    this->timer.async_wait([this](const auto &error) {
+        if (!error) {
+            this->handleTimer();
+        }
+    });
+}
+
+void Peer::finish() {
+    // Publishers do not count the time msgs stopped coming
+    const auto idleTime = std::chrono::duration<double>(Clock::now() - this->lastMsgTime).count();
+
+    // Allocations are only those of receiving msgs in a process of their own
+    if (countingAllocations && this->benchCase.transport == Transport::INTER_PROCESS && this->receivedMsgs > 1) {
+        const auto msgAllocations = allocations.load(std::memory_order_relaxed) - this->startAllocations;
+        this->replyNode->publish(ntwk::MsgTypeId::VECTOR3, makeControl(Control::ALLOCATIONS,
+            static_cast<double>(msgAllocations), static_cast<double>(this->receivedMsgs - 1)));
+    }
+    this->replyNode->publish(ntwk::MsgTypeId::VECTOR3, makeControl(Control::DONE, this->receivedMsgs, idleTime));
+    this->finished = true;
+
+    // Leave time for the msg to be sent before stopping
+    this->timer.expires_after(std::chrono::milliseconds(200));
+    this->timer.async_wait([this](const auto &error) {
+        if (!error) {
+            this->context->stop();
+        }
+    });
+}
+
+// Runs the peer of a case on a thread, or in a child process for inter-process cases. Peers
+// that fail to start are noticed by the publishers not getting ready.
+class PeerRunner {
+public:
+    explicit PeerRunner(const Case &benchCase) : benchCase(benchCase), stopped(false), child(-1) { }
+
+    bool isForked() const {
+        return this->benchCase.transport == Transport::INTER_PROCESS;
+    }
+
+    void start() {
+        if (this->isForked()) {
+            std::cout.flush();
+            std::cerr.flush();
+            this->child = fork();
+            if (this->child < 0) {
+                throw std::runtime_error("Failed to fork the peer");
+            }
+            if (this->child == 0) {
+                try {
+                    Peer(this->benchCase, this->stopped).run();
+                } catch (const std::exception &) {
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            return;
+        }
+
+        std::promise<void> advertised;
+        auto advertisedFuture = advertised.get_future();
+        this->thread = std::thread([this, advertised=std::move(advertised)]() mutable {
+            try {
+                Peer(this->benchCase, this->stopped).run(&advertised);
+            } catch (const std::exception &) { }
+        });
+
+        // Subscribers in the same process only bypass the socket once the peer advertised
+        advertisedFuture.wait();
+    }
+
+    PeerRunner(const PeerRunner &other) = delete;
+    PeerRunner &operator=(const PeerRunner &other) = delete;
+
+    ~PeerRunner() {
+        this->stopped = true;
+        if (this->thread.joinable()) {
+            this->thread.join();
+        }
+        if (this->child > 0) {
+            // Peers stop on their own shortly after reporting, or are stopped
+            const auto deadline = Clock::now() + std::chrono::seconds(2);
+            while (waitpid(this->child, nullptr, WNOHANG) == 0) {
+                if (Clock::now() >= deadline) {
+                    kill(this->child, SIGKILL);
+                    waitpid(this->child, nullptr, 0);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+private:
+    const Case &benchCase;
+    std::atomic<bool> stopped;
+    std::thread thread;
+    pid_t child;
+};
+
+// Publishers write nothing to sockets for peers in the same process, only shared memory slots
+// for msgs in shared memory and whole msgs otherwise
+void measurePath(const std::vector<std::unique_ptr<ntwk::Node>> &publishers, const Case &benchCase,
+                 Result &result) {
+    if (benchCase.transport == Transport::MULTICAST) {
+        result.path = "multicast";
+        return;
+    }
+
+    uint64_t msgs = 0;
+    uint64_t caseMsgs = 0;
+    for (const auto &publisher : publishers) {
+        const auto metrics = publisher->getMetrics().publisher;
+        for (const auto &connection : metrics.connections) {
+            msgs += connection.msgs;
+            result.socketBytes += connection.bytes;
+        }
+        for (const auto &topic : metrics.topics) {
+            if (topic.msgTypeId == benchCase.msgTypeId) {
+                caseMsgs += topic.msgs;
+            }
+        }
+    }
+
+    if (caseMsgs == 0) {
+        result.path = "intra_process";
+    } else if (result.socketBytes <= msgs * SHARED_MEMORY_MSG_SIZE) {
+        result.path = "shared_memory";
+    } else if (result.socketBytes >= caseMsgs * (MSG_HEADER_SIZE + benchCase.msg->size())) {
+        result.path = "socket";
+    } else {
+        result.path = "shared_memory_and_socket";
+    }
+}
+
+Result runCase(const Case &benchCase) {
+    Result result;
+
+    // Fork while this is the only thread, as the Nodes of previous cases are gone. Peers on a
+    // thread start once the publishers advertised, so that they bypass the socket.
+    PeerRunner peer(benchCase);
+    if (peer.isForked()) {
+        peer.start();
+    }
+
+    auto context = std::make_shared<asio::io_context>();
+    auto runtime = std::make_shared<ntwk::NetworkRuntime>();
+    std::vector<std::unique_ptr<ntwk::Node>> publishers;
+    for (unsigned int endpoint = 0; endpoint < benchCase.endpoints; ++endpoint) {
+        publishers.emplace_back(std::make_unique<ntwk::Node>(context, runtime));
+        publishers.back()->advertise(benchCase.getUri(endpoint + 1), benchCase.windowSize);
+        publishers.back()->setQoS(benchCase.msgTypeId, ntwk::QoS::keepAll(MAX_QUEUED_BYTES));
+    }
+    if (!peer.isForked()) {
+        peer.start();
+    }
+
+    bool ready = false;
+    bool done = false;
+    double idleTime = 0;
+    Clock::time_point doneTime;
+
+    // Echoes are timed where they are handled, which may be the network thread
+    std::atomic<uint64_t> echoedMsgs(0);
+    Clock::time_point echoTime;
+    auto &replyNode = *publishers.front();
+    replyNode.subscribe(benchCase.getUri(0), ntwk::MsgTypeId::VECTOR3, [&](ntwk::MsgPtr &&msg) {
+        const auto control = msgs::GetVector3(msg.get());
+        if (control->x() == static_cast<float>(Control::READY)) {
+            ready = true;
+        } else if (control->x() == static_cast<float>(Control::ALLOCATIONS)) {
+            result.countedAllocations = true;
+            result.allocationsPerMsg = control->y() / control->z();
+        } else if (control->x() == static_cast<float>(Control::DONE)) {
+            done = true;
+            doneTime = Clock::now();
+            result.receivedMsgs = static_cast<uint64_t>(control->y());
+            idleTime = control->z();
+        }
+    }, ntwk::QoS::keepAll(MAX_QUEUED_BYTES));
+    if (benchCase.benchmark == Benchmark::ROUND_TRIP) {
+        const auto onNetworkThread = benchCase.dispatch == ntwk::Dispatch::Target::NETWORK_THREAD;
+        replyNode.subscribe(benchCase.getUri(0), benchCase.msgTypeId, [&, onNetworkThread](ntwk::MsgPtr &&) {
+            echoTime = Clock::now();
+            echoedMsgs.fetch_add(1, std::memory_order_release);
+
+            // Wake up the context waiting for the echo
+            if (onNetworkThread) {
+                asio::post(*context, []{});
+            }
+        }, ntwk::QoS::keepAll(MAX_QUEUED_BYTES), makeDispatch(benchCase.dispatch, *context));
+    }
+
+    auto work = asio::make_work_guard(*context);
+
+    // Greet the peer until all its subscriptions are connected
+    const auto hello = makeControl(Control::HELLO);
+    const auto readyDeadline = Clock::now() + READY_TIMEOUT;
+    while (!runUntil(*context, std::min(Clock::now() + CONTROL_PERIOD, readyDeadline), [&]{ return ready; })) {
+        if (Clock::now() >= readyDeadline) {
+            throw std::runtime_error("Timed out waiting for the peer");
+        }
+        for (auto &publisher : publishers) {
+            publisher->publish(ntwk::MsgTypeId::VECTOR3, hello);
+        }
+    }
+
+    if (benchCase.benchmark == Benchmark::ROUND_TRIP) {
+        for (unsigned int i = 0; i < benchCase.warmupMsgs + benchCase.msgs; ++i) {
+            const auto expectedMsgs = i + 1;
+            const auto start = Clock::now();
+            replyNode.publish(benchCase.msgTypeId, benchCase.msg);
+            if (!runUntil(*context, start + ECHO_TIMEOUT, [&]{
+                return echoedMsgs.load(std::memory_order_acquire) >= expectedMsgs;
+            })) {
+                throw std::runtime_error("Timed out waiting for an echo");
+            }
+            if (i >= benchCase.warmupMsgs) {
+                result.roundTripTime.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    echoTime - start).count());
+            }
+        }
+
+        // Peers counting allocations report them once they received every msg
+        if (countingAllocations && peer.isForked() &&
+                !runUntil(*context, Clock::now() + DONE_TIMEOUT, [&]{ return done; })) {
+            throw std::runtime_error("Timed out waiting for the peer to count allocations");
+        }
+        result.receivedMsgs = result.roundTripTime.getCount();
+        measurePath(publishers, benchCase, result);
+        return result;
+    }
+
+    const auto start = Clock::now();
+    for (unsigned int i = 0; i < benchCase.msgs; ++i) {
+        for (auto &publisher : publishers) {
+            publisher->publish(benchCase.msgTypeId, benchCase.msg);
+        }
+        if (benchCase.transport == Transport::MULTICAST) {
+            runUntil(*context, start + (i + 1) * MULTICAST_PERIOD, []{ return false; });
+        }
+    }
+    if (!runUntil(*context, start + DONE_TIMEOUT, [&]{ return done; })) {
+        throw std::runtime_error("Timed out waiting for the peer to receive the msgs");
+    }
+
+    // Msgs of publishers to the same group must not be mistaken for each other's lost fragments
+    if (benchCase.transport == Transport::MULTICAST && result.receivedMsgs < benchCase.getExpectedMsgs()) {
+        throw std::runtime_error("Received " + std::to_string(result.receivedMsgs) + " of " +
+                                 std::to_string(benchCase.getExpectedMsgs()) + " multicast msgs");
+    }
+    result.seconds = std::max(std::chrono::duration<double>(doneTime - start).count() - idleTime, 1e-9);
+    measurePath(publishers, benchCase, result);
+    return result;
+}
+
+// Scales up the msgs of cases over too soon for their rate to tell anything
+Result runTimedCase(Case &benchCase) {
+    auto result = runCase(benchCase);
+    while (benchCase.benchmark != Benchmark::ROUND_TRIP && result.seconds < MIN_SECONDS &&
+           benchCase.msgs < MAX_MSGS) {
+        const auto msgs = std::ceil(benchCase.msgs * 1.25 * MIN_SECONDS / result.seconds);
+        benchCase.msgs = static_cast<unsigned int>(std::min<double>(std::max<double>(msgs, benchCase.msgs * 2.0),
+                                                                    MAX_MSGS));
+        result = runCase(benchCase);
+    }
+    return result;
+}
+
+struct Options {
+    std::string output;
+    unsigned short port = 21000;
+    bool quick = false;
+    bool countAllocations = false;
+    std::vector<Benchmark> benchmarks{Benchmark::ROUND_TRIP, Benchmark::THROUGHPUT, Benchmark::FAN_OUT,
+                                      Benchmark::ENDPOINTS, Benchmark::MULTICAST};
+};
+
+void printUsage() {
+    std::cerr << "Usage: network_bench [--output FILE] [--port PORT] [--quick] [--count-allocations]\n"
+                 "                     [--benchmark round_trip|throughput|fan_out|endpoints|multicast]...\n"
+                 "\n"
+                 "  --output             Write the JSON results to FILE instead of stdout\n"
+                 "  --port               First of the ports the benchmarks use, default 21000\n"
+                 "  --quick              Publish a tenth of the msgs, or enough for cases to last 0.2 s\n"
+                 "  --count-allocations  Count the allocations per msg of peers in another process\n"
+                 "  --benchmark          Only run the given benchmarks\n";
+}
+
+Options parseOptions(int argc, char *argv[]) {
+    Options options;
+    std::vector<Benchmark> benchmarks;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto hasValue = i + 1 < argc;
+        if (arg == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "--port" && hasValue) {
+            options.port = static_cast<unsigned short>(std::stoul(argv[++i]));
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--count-allocations") {
+            options.countAllocations = true;
+        } else if (arg == "--benchmark" && hasValue) {
+            const std::string name = argv[++i];
+            const auto benchmark = std::find_if(options.benchmarks.cbegin(), options.benchmarks.cend(),
+                                                [&name](auto benchmark) { return name == getName(benchmark); });
+            if (benchmark == options.benchmarks.cend()) {
+                throw std::invalid_argument("Unknown benchmark " + name);
+            }
+            benchmarks.push_back(*benchmark);
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+
+    if (!benchmarks.empty()) {
+        options.benchmarks = benchmarks;
+    }
+    return options;
+}
+
+std::vector<Case> makeCases(const Options &options) {
+    const auto scale = [&options](unsigned int msgs) {
+        return options.quick ? std::max(msgs / 10, 4u) : msgs;
+    };
+
+    const std::vector<Transport> transports{Transport::INTRA_PROCESS, Transport::INTER_PROCESS};
+    const std::vector<Transport> multicastTransports{Transport::MULTICAST};
+    const std::vector<ntwk::Dispatch::Target> dispatches{ntwk::Dispatch::Target::MAIN_CONTEXT,
+                                                         ntwk::Dispatch::Target::NETWORK_THREAD,
+                                                         ntwk::Dispatch::Target::EXECUTOR};
+
+    struct Payload {
+        std::string name;
+        ntwk::MsgTypeId msgTypeId;
+        std::function<MsgBuffer()> make;
+    };
+    const std::vector<Payload> smallPayloads{
+        {"twist", ntwk::MsgTypeId::TWIST, makeTwist},
+        {"joystick", ntwk::MsgTypeId::JOYSTICK, makeJoystick}
+    };
+    const std::vector<Payload> largePayloads{
+        {"uint8_array_64k", ntwk::MsgTypeId::UINT8_ARRAY, []{ return makeUint8Array(64 * 1024); }},
+        {"uint8_array_1m", ntwk::MsgTypeId::UINT8_ARRAY, []{ return makeUint8Array(1024 * 1024); }},
+        {"uint8_array_8m", ntwk::MsgTypeId::UINT8_ARRAY, []{ return makeUint8Array(8 * 1024 * 1024); }},
+        {"uint8_array_25m", ntwk::MsgTypeId::UINT8_ARRAY, []{ return makeUint8Array(25 * 1024 * 1024); }},
+        {"image_640x480", ntwk::MsgTypeId::IMAGE, []{ return makeImage(640, 480); }},
+        {"image_1920x1080", ntwk::MsgTypeId::IMAGE, []{ return makeImage(1920, 1080); }},
+        {"image_3840x2160", ntwk::MsgTypeId::IMAGE, []{ return makeImage(3840, 2160); }}
+    };
+    const std::vector<unsigned int> counts{1, 2, 4, 8, 16, 32, 64};
+
+    std::vector<Case> cases;
+    const auto addCase = [&](Benchmark benchmark, Transport transport, const Payload &payload, MsgBuffer msg) {
+        Case benchCase;
+        benchCase.benchmark = benchmark;
+        benchCase.transport = transport;
+        benchCase.payload = payload.name;
+        benchCase.msgTypeId = payload.msgTypeId;
+        benchCase.msg = std::move(msg);
+        cases.push_back(std::move(benchCase));
+        return &cases.back();
+    };
+
+    for (const auto benchmark : options.benchmarks) {
+        for (const auto transport : benchmark == Benchmark::MULTICAST ? multicastTransports : transports) {
+            switch (benchmark) {
+            case Benchmark::ROUND_TRIP:
+                for (const auto &payload : smallPayloads) {
+                    for (const auto dispatch : dispatches) {
+                        auto benchCase = addCase(benchmark, transport, payload, payload.make());
+                        benchCase->dispatch = dispatch;
+                        benchCase->msgs = scale(2000);
+                        benchCase->warmupMsgs = scale(200);
+                    }
+                }
+                break;
+
+            case Benchmark::THROUGHPUT:
+                // About 256 MB of each payload. Windows only apply to msgs sent to another process,
+                // and matter most for the payloads sent most often.
+                for (size_t i = 0; i < largePayloads.size(); ++i) {
+                    const auto &payload = largePayloads[i];
+                    auto msg = payload.make();
+                    const auto msgs = scale(static_cast<unsigned int>(
+                        std::min<size_t>(std::max<size_t>((256u << 20) / msg->size(), 10), MAX_MSGS)));
+                    addCase(benchmark, transport, payload, msg)->msgs = msgs;
+                    if (transport == Transport::INTER_PROCESS && i < 2) {
+                        auto benchCase = addCase(benchmark, transport, payload, msg);
+                        benchCase->windowSize = 1;
+                        benchCase->msgs = msgs;
+                    }
+                }
+                break;
+
+            case Benchmark::FAN_OUT:
+                for (const auto subscribers : counts) {
+                    auto benchCase = addCase(benchmark, transport, largePayloads.front(),
+                                             largePayloads.front().make());
+                    benchCase->msgs = scale(200);
+                    benchCase->subscribers = subscribers;
+                }
+                break;
+
+            case Benchmark::ENDPOINTS:
+                for (const auto endpoints : counts) {
+                    auto benchCase = addCase(benchmark, transport, smallPayloads.front(),
+                                             smallPayloads.front().make());
+                    benchCase->msgs = scale(500);
+                    benchCase->endpoints = endpoints;
+                }
+                break;
+
+            case Benchmark::MULTICAST:
+                for (const auto endpoints : {1u, 2u}) {
+                    auto benchCase = addCase(benchmark, transport, largePayloads[1], largePayloads[1].make());
+                    benchCase->msgs = scale(50);
+                    benchCase->endpoints = endpoints;
+                }
+                break;
+            }
+        }
+    }
+
+    // Each case gets ports of its own, so peers of previous cases never connect to it
+    for (size_t i = 0; i < cases.size(); ++i) {
+        cases[i].port = static_cast<unsigned short>(options.port + (i % 256) * 80);
+    }
+    return cases;
+}
+
+std::string escapeJson(const std::string &string) {
+    std::ostringstream escaped;
+    for (const auto c : string) {
+        if (c == '"' || c == '\\') {
+            escaped << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+        } else {
+            escaped << c;
+        }
+    }
+    return escaped.str();
+}
+
+void writeResult(std::ostream &stream, const Case &benchCase, const Result &result) {
+    stream << "    {\"benchmark\": \"" << getName(benchCase.benchmark)
+           << "\", \"transport\": \"" << getName(benchCase.transport)
+           << "\", \"payload\": \"" << benchCase.payload
+           << "\", \"dispatch\": \"" << getName(benchCase.dispatch)
+           << "\", \"msg_size\": " << benchCase.msg->size()
+           << ", \"subscribers\": " << benchCase.subscribers
+           << ", \"endpoints\": " << benchCase.endpoints
+           << ", \"window_size\": " << benchCase.windowSize
+           << ", \"msgs\": " << benchCase.msgs
+           << ", \"received_msgs\": " << result.receivedMsgs;
+
+    if (!result.error.empty()) {
+        stream << ", \"error\": \"" << escapeJson(result.error) << "\"}";
+        return;
+    }
+
+    stream << ", \"path\": \"" << result.path << "\", \"socket_bytes\": " << result.socketBytes;
+    if (result.countedAllocations) {
+        stream << ", \"allocations_per_msg\": " << result.allocationsPerMsg;
+    }
+    if (benchCase.benchmark == Benchmark::ROUND_TRIP) {
+        const auto &rtt = result.roundTripTime;
+        stream << ", \"round_trip_ns\": {\"p50\": " << rtt.getPercentile(50)
+               << ", \"p90\": " << rtt.getPercentile(90)
+               << ", \"p99\": " << rtt.getPercentile(99)
+               << ", \"p99.9\": " << rtt.getPercentile(99.9)
+               << ", \"max\": " << rtt.getPercentile(100) << "}}";
+        return;
+    }
+
+    // Msgs shared within the process are not copied, so they have no rate of bytes
+    const auto bytes = static_cast<double>(result.receivedMsgs) * benchCase.msg->size();
+    stream << ", \"seconds\": " << std::fixed << std::setprecision(6) << result.seconds
+           << ", \"msgs_per_second\": " << std::setprecision(1) << result.receivedMsgs / result.seconds;
+    if (result.path != "intra_process") {
+        stream << ", \"megabytes_per_second\": " << bytes / result.seconds / 1e6;
+    }
+    stream << "}";
+    stream.unsetf(std::ios_base::floatfield);
+}
+
+} // namespace
+
+// Allocations go through malloc, so that they can be counted without changing where they go
+void *operator new(std::size_t size) {
+    if (countingAllocations.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (const auto memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n\n";
+        printUsage();
+        return 2;
+    }
+
+    // Writing to the socket of a peer that is gone must not end the benchmarks
+    signal(SIGPIPE, SIG_IGN);
+    countingAllocations = options.countAllocations;
+
+    auto cases = makeCases(options);
+    std::ostringstream results;
+    bool failed = false;
+    for (size_t i = 0; i < cases.size(); ++i) {
+        auto &benchCase = cases[i];
+        Result result;
+        try {
+            result = runTimedCase(benchCase);
+        } catch (const std::exception &e) {
+            result.error = e.what();
+            failed = true;
+        }
+
+        std::cerr << "[" << i + 1 << "/" << cases.size() << "] " << getName(benchCase.benchmark) << " "
+                  << getName(benchCase.transport) << " " << benchCase.payload
+                  << " dispatch=" << getName(benchCase.dispatch) << " subscribers=" << benchCase.subscribers
+                  << " endpoints=" << benchCase.endpoints << " window_size=" << benchCase.windowSize
+                  << (result.error.empty() ? "" : " failed: " + result.error) << "\n";
+        writeResult(results, benchCase, result);
+        results << (i + 1 < cases.size() ? ",\n" : "\n");
+    }
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "Failed to open " << options.output << "\n";
+            return 1;
+        }
+    }
+    auto &stream = options.output.empty() ? std::cout : file;
+    stream << "{\n"
+           << "  \"version\": \"" << NETWORK_VERSION << "\",\n"
+           << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+           << "  \"quick\": " << (options.quick ? "true" : "false") << ",\n"
+           << "  \"results\": [\n" << results.str() << "  ]\n"
+           << "}\n";
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <utility>
+
+#include <asio/any_io_executor.hpp>
+
+namespace ntwk {
+
+// Where the msg handler of a subscription runs. By default msgs are queued according to the
+// QoS of the subscription and handled on the main context. Handlers on the network thread run
+// as soon as a msg is received and must not block, while handlers on an executor get each msg
+// posted to it. Neither queues msgs, so the QoS of the subscription does not apply.
+struct Dispatch {
+    enum class Target {
+        MAIN_CONTEXT,
+        NETWORK_THREAD,
+        EXECUTOR
+    };
+
+    Target target = Target::MAIN_CONTEXT;
+    asio::any_io_executor executor;
+
+    static Dispatch networkThread() {
+        Dispatch dispatch;
+        dispatch.target = Target::NETWORK_THREAD;
+        return dispatch;
+    }
+
+    static Dispatch onExecutor(asio::any_io_executor executor) {
+        Dispatch dispatch;
+        dispatch.target = Target::EXECUTOR;
+        dispatch.executor = std::move(executor);
+        return dispatch;
+    }
+};
+
+} // namespace ntwk
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ntwk {
+
+// Recycles the memory of the completion handlers of a connection. Each connection only has a
+// few asynchronous operations pending at a time, so a handful of blocks covers them in steady
+// state and larger or excess handlers fall back to the heap. Blocks may be released on another
+// thread than the one they were taken on, for handlers posted to the main context.
+//
+// The memory must outlive the handlers using it, which holds when the handlers own the object
+// the memory belongs to: asio releases a handler's memory before destroying the handler.
+class HandlerMemory {
+public:
+    HandlerMemory() {
+        for (auto &used : this->usedBlocks) {
+            used.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    HandlerMemory(const HandlerMemory &other) = delete;
+    HandlerMemory &operator=(const HandlerMemory &other) = delete;
+
+    void *allocate(size_t size) {
+        if (size <= BLOCK_SIZE) {
+            for (size_t i = 0; i < BLOCK_COUNT; ++i) {
+                if (!this->usedBlocks[i].load(std::memory_order_relaxed) &&
+                        !this->usedBlocks[i].exchange(true, std::memory_order_acquire)) {
+                    return &this->blocks[i];
+                }
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void *pointer) {
+        const auto block = static_cast<Block *>(pointer);
+        if (block >= this->blocks && block < this->blocks + BLOCK_COUNT) {
+            this->usedBlocks[block - this->blocks].store(false, std::memory_order_release);
+        } else {
+            ::operator delete(pointer);
+        }
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 512;
+    static constexpr size_t BLOCK_COUNT = 4;
+
+    using Block = std::aligned_storage_t<BLOCK_SIZE, alignof(std::max_align_t)>;
+
+    Block blocks[BLOCK_COUNT];
+    std::atomic<bool> usedBlocks[BLOCK_COUNT];
+};
+
+// Allocator handed to asio as the associated allocator of a handler
+template<typename T>
+class HandlerAllocator {
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory &memory) noexcept : memory(&memory) { }
+
+    template<typename U>
+    HandlerAllocator(const HandlerAllocator<U> &other) noexcept : memory(other.memory) { }
+
+    T *allocate(size_t n) const {
+        return static_cast<T *>(this->memory->allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T *pointer, size_t) const {
+        this->memory->deallocate(pointer);
+    }
+
+    template<typename U>
+    bool operator==(const HandlerAllocator<U> &other) const noexcept {
+        return this->memory == other.memory;
+    }
+
+    template<typename U>
+    bool operator!=(const HandlerAllocator<U> &other) const noexcept {
+        return this->memory != other.memory;
+    }
+
+private:
+    template<typename U>
+    friend class HandlerAllocator;
+
+    HandlerMemory *memory;
+};
+
+template<typename Handler>
+class MemoryBoundHandler {
+public:
+    using allocator_type = HandlerAllocator<void>;
+
+    MemoryBoundHandler(HandlerMemory &memory, Handler handler) :
+        memory(memory), handler(std::move(handler)) { }
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type(this->memory);
+    }
+
+    template<typename... Args>
+    void operator()(Args &&... args) {
+        this->handler(std::forward<Args>(args)...);
+    }
+
+private:
+    HandlerMemory &memory;
+    Handler handler;
+};
+
+// Has asio allocate the handler's operations from the given memory
+template<typename Handler>
+MemoryBoundHandler<std::decay_t<Handler>> bindHandlerMemory(HandlerMemory &memory, Handler &&handler) {
+    return MemoryBoundHandler<std::decay_t<Handler>>(memory, std::forward<Handler>(handler));
+}
+
+} // namespace ntwk
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 
 #include <flatbuffers/flatbuffers.h>
 
+#include "MsgPtr.h"
+
 namespace ntwk {
 
 struct Image {
@@ -21,4 +24,45 @@ struct Image {
     static Image makeImage(const uint8_t buffer[]);
 };
 
+// Image of a received msg read in place, without copying the pixel data out of the msg. Rows
+// are stride bytes apart. A view made from a buffer only points into it and must not outlive
+// it, while a view made from a MsgPtr owns the msg.
+struct ImageView {
+    unsigned int width;
+    unsigned int height;
+    uint8_t channels;
+    size_t stride;
+    const uint8_t *data;
+
+    explicit ImageView(const uint8_t buffer[]);
+    explicit ImageView(MsgPtr &&msg);
+
+private:
+    MsgPtr msg;
+};
+
+// Image msg whose pixel data is filled in place, e.g. decoded or DMAed straight into the msg,
+// rather than copied into it by Image::makeBuffer
+class ImageBuffer {
+public:
+    ImageBuffer(unsigned int width, unsigned int height, uint8_t channels);
+
+    // width * height * channels bytes of pixel data
+    uint8_t *getData() {
+        return this->data;
+    }
+
+    size_t getSize() const {
+        return this->size;
+    }
+
+    // Hands out the msg for publishing, after which the pixel data must no longer be written
+    std::shared_ptr<flatbuffers::DetachedBuffer> release();
+
+private:
+    flatbuffers::FlatBufferBuilder builder;
+    uint8_t *data;
+    size_t size;
+};
+
 } // namespace ntwk
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MsgTypeId.h"
+
+namespace ntwk {
+
+// Msgs of a msg type sent to or received from sockets. Overwritten and dropped msgs were lost
+// to full queues, queued msgs are waiting to be sent or handled.
+struct TopicMetrics {
+    MsgTypeId msgTypeId{};
+    uint64_t msgs = 0;
+    uint64_t bytes = 0;
+    uint64_t overwrittenMsgs = 0;
+    uint64_t droppedMsgs = 0;
+    uint64_t queuedMsgs = 0;
+};
+
+// Msgs sent or received through a connection, with the bytes of their headers. Times are in
+// nanoseconds: sendTime adds up the time taken by writes to the socket, of msgs by publishers
+// and of acks by subscribers, and the round trip time from sending msgs to their ack is
+// smoothed over the acks received by publishers. Subscribers count their queued msgs by topic
+// and the times their connection was lost as reconnects.
+struct ConnectionMetrics {
+    std::string endpoint;
+    uint64_t msgs = 0;
+    uint64_t bytes = 0;
+    uint64_t queuedMsgs = 0;
+    uint64_t sendTime = 0;
+    uint64_t ackRoundTripTime = 0;
+    uint64_t reconnects = 0;
+};
+
+// Connections accepted by the publisher, by the endpoint of the subscriber
+struct PublisherMetrics {
+    std::vector<TopicMetrics> topics;
+    std::vector<ConnectionMetrics> connections;
+};
+
+struct SubscriberMetrics {
+    ConnectionMetrics connection;
+    std::vector<TopicMetrics> topics;
+};
+
+// Snapshot of the counters of a Node, which are kept without locks while msgs are published
+// and received. Subscribers are listed by the uri of their endpoint, as "tcp://host:port" or
+// "unix:///path/to/socket". Multicast publishers and subscribers are not covered.
+struct Metrics {
+    PublisherMetrics publisher;
+    std::map<std::string, SubscriberMetrics> subscribers;
+};
+
+} // namespace ntwk
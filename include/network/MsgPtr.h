@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace ntwk {
+
+// Releases a received msg. Msgs received over a socket are owned exclusively and their buffer
+// is returned to the subscriber for the next msgs, while msgs from publishers in the same
+// process or in shared memory are shared with the publisher and other subscribers and only
+// release their owner. Received msgs are therefore const.
+class MsgDeleter {
+public:
+    MsgDeleter() = default;
+    explicit MsgDeleter(std::shared_ptr<const void> owner) : owner(std::move(owner)) { }
+
+    void operator()(const uint8_t msg[]) {
+        if (this->owner) {
+            this->owner.reset();
+        } else {
+            delete[] msg;
+        }
+    }
+
+private:
+    std::shared_ptr<const void> owner;
+};
+
+using MsgPtr = std::unique_ptr<const uint8_t[], MsgDeleter>;
+
+// Buffer a msg is received into, handed to subscribers as a MsgPtr
+using MutableMsgPtr = std::unique_ptr<uint8_t[], MsgDeleter>;
+
+} // namespace ntwk
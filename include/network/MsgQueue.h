@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+#include "QoS.h"
+
+namespace ntwk {
+
+// Pending msgs of a single msg type, bounded according to its QoS
+template<typename Msg>
+class MsgQueue {
+public:
+    enum class Result {
+        QUEUED,
+        OVERWRITTEN,
+        DROPPED
+    };
+
+    explicit MsgQueue(const QoS &qos=QoS()) : qos(qos), queuedBytes(0) { }
+
+    void setQoS(const QoS &qos) {
+        this->qos = qos;
+    }
+
+    // Overwriting removes the oldest msg, so the new msg is not counted as an additional msg
+    Result push(Msg &&msg, size_t msgSize) {
+        if (this->qos.history == QoS::History::KEEP_ALL) {
+            if (this->queuedBytes + msgSize > this->qos.maxBytes) {
+                return Result::DROPPED;
+            }
+        } else if (this->msgs.size() >= this->qos.depth) {
+            this->msgs.emplace_back(std::move(msg), msgSize);
+            this->queuedBytes += msgSize;
+            while (this->msgs.size() > this->qos.depth) {
+                this->pop();
+            }
+            return Result::OVERWRITTEN;
+        }
+
+        this->msgs.emplace_back(std::move(msg), msgSize);
+        this->queuedBytes += msgSize;
+        return Result::QUEUED;
+    }
+
+    Msg pop() {
+        auto msg = std::move(this->msgs.front());
+        this->msgs.pop_front();
+        this->queuedBytes -= msg.second;
+        return std::move(msg.first);
+    }
+
+    bool empty() const {
+        return this->msgs.empty();
+    }
+
+    size_t size() const {
+        return this->msgs.size();
+    }
+
+private:
+    QoS qos;
+    std::deque<std::pair<Msg, size_t>> msgs;
+    size_t queuedBytes;
+};
+
+} // namespace ntwk
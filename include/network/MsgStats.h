@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace ntwk {
+
+// Histogram of latencies in nanoseconds, bucketed like an HDR histogram: latencies below
+// 2^SUB_BUCKET_BITS ns get a bucket each and larger latencies share their bucket with
+// latencies within 1/2^SUB_BUCKET_BITS of them. Latencies beyond 2^MAX_LATENCY_BITS ns
+// (about 18 minutes) are counted in the last bucket.
+class LatencyHistogram {
+public:
+    static constexpr unsigned int SUB_BUCKET_BITS = 5;
+    static constexpr unsigned int MAX_LATENCY_BITS = 40;
+    static constexpr size_t BUCKET_COUNT = (MAX_LATENCY_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    static size_t getBucket(uint64_t latency);
+
+    // Lowest latency counted in the bucket
+    static uint64_t getBucketLatency(size_t bucket);
+
+    void record(uint64_t latency) {
+        this->add(getBucket(latency), 1);
+    }
+
+    void add(size_t bucket, uint64_t count) {
+        this->counts[bucket] += count;
+        this->count += count;
+    }
+
+    uint64_t getCount() const {
+        return this->count;
+    }
+
+    // Highest latency within the lowest percentile (0 to 100) of the latencies, 0 without any
+    uint64_t getPercentile(double percentile) const;
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> counts{};
+    uint64_t count = 0;
+};
+
+// Stamped msgs of a msg type received from a publisher. Gaps in their sequence numbers count
+// the msgs the publisher overwrote or dropped for the subscriber, losses in the subscriber's
+// own queue are counted by its QueueStats. Latencies are measured from publishing msgs to
+// calling their handler.
+struct MsgStats {
+    uint64_t receivedMsgs = 0;
+    uint64_t missedMsgs = 0;
+    uint64_t gaps = 0;
+    LatencyHistogram latency;
+};
+
+} // namespace ntwk
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <flatbuffers/flatbuffers.h>
+
+#include "MsgPtr.h"
+#include "MsgTypeId.h"
+#include "msgs/Image_generated.h"
+#include "msgs/Joystick_generated.h"
+#include "msgs/Twist_generated.h"
+#include "msgs/Uint8Array_generated.h"
+#include "msgs/Vector3_generated.h"
+
+namespace ntwk {
+
+// Maps a msg table to its name, the msg type id it is published with by default and the msg
+// type ids allowed to carry it. Received msgs of a type with VERIFY set are checked against the schema,
+// including their bounds and alignment, before a handler reads them; msgs failing the check
+// are dropped.
+template<typename Msg>
+struct MsgTraits;
+
+template<>
+struct MsgTraits<msgs::Image> {
+    static constexpr const char *getName() {
+        return "msgs.Image";
+    }
+
+    static constexpr MsgTypeId MSG_TYPE_ID = MsgTypeId::IMAGE;
+    static constexpr bool VERIFY = true;
+
+    static constexpr bool carries(MsgTypeId msgTypeId) {
+        return msgTypeId == MSG_TYPE_ID;
+    }
+};
+
+template<>
+struct MsgTraits<msgs::Joystick> {
+    static constexpr const char *getName() {
+        return "msgs.Joystick";
+    }
+
+    static constexpr MsgTypeId MSG_TYPE_ID = MsgTypeId::JOYSTICK;
+    static constexpr bool VERIFY = true;
+
+    static constexpr bool carries(MsgTypeId msgTypeId) {
+        return msgTypeId == MSG_TYPE_ID;
+    }
+};
+
+template<>
+struct MsgTraits<msgs::Twist> {
+    static constexpr const char *getName() {
+        return "msgs.Twist";
+    }
+
+    static constexpr MsgTypeId MSG_TYPE_ID = MsgTypeId::TWIST;
+    static constexpr bool VERIFY = true;
+
+    static constexpr bool carries(MsgTypeId msgTypeId) {
+        return msgTypeId == MSG_TYPE_ID;
+    }
+};
+
+// Also carries jpeg compressed images
+template<>
+struct MsgTraits<msgs::Uint8Array> {
+    static constexpr const char *getName() {
+        return "msgs.Uint8Array";
+    }
+
+    static constexpr MsgTypeId MSG_TYPE_ID = MsgTypeId::UINT8_ARRAY;
+    static constexpr bool VERIFY = true;
+
+    static constexpr bool carries(MsgTypeId msgTypeId) {
+        return msgTypeId == MSG_TYPE_ID || msgTypeId == MsgTypeId::IMAGE_JPEG;
+    }
+};
+
+template<>
+struct MsgTraits<msgs::Vector3> {
+    static constexpr const char *getName() {
+        return "msgs.Vector3";
+    }
+
+    static constexpr MsgTypeId MSG_TYPE_ID = MsgTypeId::VECTOR3;
+    static constexpr bool VERIFY = true;
+
+    static constexpr bool carries(MsgTypeId msgTypeId) {
+        return msgTypeId == MSG_TYPE_ID;
+    }
+};
+
+// Received msg read in place, owning the buffer it was received in
+template<typename Msg>
+class ReceivedMsg {
+public:
+    ReceivedMsg(MsgPtr &&buffer, size_t size) :
+        buffer(std::move(buffer)), size(size), msg(flatbuffers::GetRoot<Msg>(this->buffer.get())) { }
+
+    // Whether the msg is well formed, which is only checked for msg types with VERIFY set
+    static bool verify(const uint8_t buffer[], size_t size) {
+        if (!MsgTraits<Msg>::VERIFY) {
+            return true;
+        }
+        flatbuffers::Verifier verifier(buffer, size);
+        return verifier.VerifyBuffer<Msg>(nullptr);
+    }
+
+    const Msg *get() const {
+        return this->msg;
+    }
+
+    const Msg *operator->() const {
+        return this->msg;
+    }
+
+    const Msg &operator*() const {
+        return *this->msg;
+    }
+
+    const uint8_t *getBuffer() const {
+        return this->buffer.get();
+    }
+
+    size_t getSize() const {
+        return this->size;
+    }
+
+    // Takes over the buffer, after which the msg must no longer be read
+    MsgPtr release() {
+        this->msg = nullptr;
+        return std::move(this->buffer);
+    }
+
+private:
+    MsgPtr buffer;
+    size_t size;
+    const Msg *msg;
+};
+
+} // namespace ntwk
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <asio/io_context.hpp>
+
+#include "Thread.h"
+
+namespace ntwk {
+
+// Network threads shared by the Nodes of a process. All Nodes attached to the runtime serve
+// their connections on its fixed number of threads, each connection on its own strand.
+// Workers are pinned round robin to the given CPUs, if any.
+class NetworkRuntime {
+private:
+    using ContextPtr = std::shared_ptr<asio::io_context>;
+
+public:
+    explicit NetworkRuntime(unsigned int threadCount=1, const std::vector<unsigned int> &cpus={});
+
+    NetworkRuntime(const NetworkRuntime &other) = delete;
+    NetworkRuntime &operator=(const NetworkRuntime &other) = delete;
+
+    const ContextPtr &getContext() const;
+    unsigned int getThreadCount() const;
+
+private:
+    ContextPtr context;
+    std::vector<std::unique_ptr<Thread>> threads;
+};
+
+} // namespace ntwk
@@ -1,51 +1,144 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
+#include <string>
+#include <type_traits>
 #include <utility>
 
 #include <asio/io_context.hpp>
+#include <asio/steady_timer.hpp>
 #include <flatbuffers/flatbuffers.h>
 
+#include "Dispatch.h"
+#include "Metrics.h"
+#include "MsgPtr.h"
+#include "MsgStats.h"
 #include "MsgTypeId.h"
-#include "Thread.h"
+#include "NetworkRuntime.h"
+#include "QoS.h"
+#include "Topic.h"
 
 namespace ntwk {
 
 class TcpPublisher;
 class TcpSubscriber;
+class UdpPublisher;
+class UdpSubscriber;
+
+template<typename Msg, MsgTypeId MSG_TYPE_ID>
+class Subscriber;
 
 class Node {
 private:
     using Endpoint = std::pair<std::string, unsigned short>;
     using ContextPtr = std::shared_ptr<asio::io_context>;
+    using RuntimePtr = std::shared_ptr<NetworkRuntime>;
     using PublisherPtr = std::shared_ptr<TcpPublisher>;
     using SubscriberPtr = std::shared_ptr<TcpSubscriber>;
-    using MsgHandler = std::function<void(std::unique_ptr<uint8_t[]> &&)>;
+    using MulticastPublisherPtr = std::shared_ptr<UdpPublisher>;
+    using MulticastSubscriberPtr = std::shared_ptr<UdpSubscriber>;
+    using MsgHandler = std::function<void(MsgPtr &&)>;
+    using SizedMsgHandler = std::function<void(MsgPtr &&, size_t)>;
+    using MetricsHandler = std::function<void(const Metrics &)>;
 
 public:
 
-    explicit Node(ContextPtr context=std::make_shared<asio::io_context>());
+    // Network IO runs on ntwkThreadCount threads of the Node's own with each connection
+    // serialized on a strand
+    explicit Node(ContextPtr context=std::make_shared<asio::io_context>(),
+                  unsigned int ntwkThreadCount=1);
+
+    // Network IO runs on the threads of a runtime shared with other Nodes
+    Node(ContextPtr context, RuntimePtr ntwkRuntime);
+
+    // Waits for the connections to close on the network threads, so msg handlers running there
+    // must not destroy Nodes
     ~Node();
 
-    void advertise(unsigned short port);
-    void subscribe(const Endpoint &endpoint, MsgTypeId msgTypeId, MsgHandler msgHandler);
+    void advertise(unsigned short port, unsigned int windowSize=16);
+
+    // Endpoints are "tcp://host:port" or "unix:///path/to/socket". Msgs to a multicast
+    // group "udp://group:port" are sent once for all subscribers but may be lost. Subscribers
+    // are kept by endpoint, so "host:port" and "tcp://host:port" name the same subscriber.
+    void advertise(const std::string &endpoint, unsigned int windowSize=16);
+
+    // Msg handlers run on the main context unless dispatched otherwise
+    void subscribe(const Endpoint &endpoint, MsgTypeId msgTypeId, MsgHandler msgHandler,
+                   const QoS &qos=QoS(), const Dispatch &dispatch=Dispatch());
+
+    // Templated so that braced {host, port} arguments still select the Endpoint overload
+    template<typename Uri, typename = std::enable_if_t<std::is_convertible<Uri, std::string>::value>>
+    void subscribe(const Uri &endpoint, MsgTypeId msgTypeId, MsgHandler msgHandler,
+                   const QoS &qos=QoS(), const Dispatch &dispatch=Dispatch()) {
+        this->subscribeUri(endpoint, msgTypeId, withoutSize(std::move(msgHandler)), qos, dispatch);
+    }
+
+    // Subscribing to a topic registers it, see registerTopic
+    void subscribe(const Endpoint &endpoint, const Topic &topic, MsgHandler msgHandler,
+                   const QoS &qos=QoS(), const Dispatch &dispatch=Dispatch());
+
+    template<typename Uri, typename = std::enable_if_t<std::is_convertible<Uri, std::string>::value>>
+    void subscribe(const Uri &endpoint, const Topic &topic, MsgHandler msgHandler,
+                   const QoS &qos=QoS(), const Dispatch &dispatch=Dispatch()) {
+        registerTopic(topic);
+        this->subscribeUri(endpoint, topic, withoutSize(std::move(msgHandler)), qos, dispatch);
+    }
 
     void publish(MsgTypeId msgTypeId, std::shared_ptr<flatbuffers::DetachedBuffer> msg);
 
+    // Publishing to a topic registers it for every msg. Typed publishers register it once.
+    void publish(const Topic &topic, std::shared_ptr<flatbuffers::DetachedBuffer> msg);
+
+    // Queueing of published msgs of the msg type, once advertised
+    void setQoS(MsgTypeId msgTypeId, const QoS &qos);
+
+    // Msgs overwritten or dropped by full queues of the publisher or of a subscriber
+    QueueStats getQueueStats(MsgTypeId msgTypeId) const;
+    QueueStats getQueueStats(const std::string &endpoint, MsgTypeId msgTypeId) const;
+
+    // Latencies and msgs missed of a msg type subscribed to. Only msgs received through a socket
+    // are stamped, not msgs from publishers in the same process or from multicast groups.
+    MsgStats getMsgStats(const std::string &endpoint, MsgTypeId msgTypeId) const;
+
+    Metrics getMetrics() const;
+
+    // Hands a snapshot of the metrics to the handler on the main context every period, until
+    // replaced by another handler or an empty one
+    void setMetricsHandler(std::chrono::milliseconds period, MetricsHandler metricsHandler);
+
     void run();
     void runOnce();
 
 private:
+    // Typed subscribers also get the size of each msg to verify it
+    template<typename Msg, MsgTypeId MSG_TYPE_ID>
+    friend class Subscriber;
+
+    static SizedMsgHandler withoutSize(MsgHandler msgHandler);
+    void subscribeUri(const std::string &endpoint, MsgTypeId msgTypeId, SizedMsgHandler msgHandler,
+                      const QoS &qos, const Dispatch &dispatch);
+    void scheduleMetricsHandler();
+
     ContextPtr mainContext;
+    RuntimePtr ntwkRuntime;
     ContextPtr ntwkContext;
 
-    std::map<Endpoint, SubscriberPtr> subscribers;
+    std::map<std::string, SubscriberPtr> subscribers;
+    std::map<std::string, MulticastSubscriberPtr> multicastSubscribers;
     PublisherPtr publisher;
+    MulticastPublisherPtr multicastPublisher;
 
-    Thread ntwkThread;
+    // Only created once a handler is set, as timers add work to every run of the main context.
+    // Waits already done when the handler is replaced are told apart by the generation.
+    std::unique_ptr<asio::steady_timer> metricsTimer;
+    std::chrono::milliseconds metricsPeriod;
+    MetricsHandler metricsHandler;
+    unsigned int metricsGeneration;
 };
 
 } // namespace ntwk
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include <flatbuffers/flatbuffers.h>
+
+#include "MsgTraits.h"
+#include "MsgTypeId.h"
+#include "Node.h"
+#include "QoS.h"
+#include "Topic.h"
+
+namespace ntwk {
+
+// Publishes msgs of a single msg table through an advertised Node, so the msg type id always
+// matches the msgs. Msg tables carried by several msg type ids are published with the one given.
+// Publishing to a topic instead tags the msgs with the topic's id, for any msg table, and
+// registers the msg table with the topic.
+template<typename Msg, MsgTypeId MSG_TYPE_ID = MsgTraits<Msg>::MSG_TYPE_ID>
+class Publisher {
+public:
+    static_assert(MsgTraits<Msg>::carries(MSG_TYPE_ID), "The msg type id does not carry the msg");
+
+    explicit Publisher(Node &node) : node(node), msgTypeId(MSG_TYPE_ID) { }
+
+    Publisher(Node &node, const Topic &topic) : node(node), msgTypeId(topic) {
+        registerTopic(topic, MsgTraits<Msg>::getName());
+    }
+
+    void publish(std::shared_ptr<flatbuffers::DetachedBuffer> msg) {
+        this->node.publish(this->msgTypeId, std::move(msg));
+    }
+
+    // Finishes the msg built with the builder and publishes it
+    void publish(flatbuffers::FlatBufferBuilder &builder, flatbuffers::Offset<Msg> msg) {
+        builder.Finish(msg);
+        this->publish(std::make_shared<flatbuffers::DetachedBuffer>(builder.Release()));
+    }
+
+    void setQoS(const QoS &qos) {
+        this->node.setQoS(this->msgTypeId, qos);
+    }
+
+    QueueStats getQueueStats() const {
+        return this->node.getQueueStats(this->msgTypeId);
+    }
+
+private:
+    Node &node;
+    MsgTypeId msgTypeId;
+};
+
+} // namespace ntwk
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace ntwk {
+
+// Queueing of pending msgs of a msg type. KEEP_LAST keeps the latest depth msgs and overwrites
+// the oldest one when full. KEEP_ALL keeps every msg until maxBytes are queued and then drops
+// newer msgs. The default keeps only the latest msg. Subscribers hand at most 1024 msgs of a
+// KEEP_ALL msg type to the main context at a time.
+struct QoS {
+    enum class History {
+        KEEP_LAST,
+        KEEP_ALL
+    };
+
+    History history = History::KEEP_LAST;
+    size_t depth = 1;
+    size_t maxBytes = 0;
+
+    static QoS keepLast(size_t depth) {
+        QoS qos;
+        qos.depth = std::max<size_t>(depth, 1);
+        return qos;
+    }
+
+    static QoS keepAll(size_t maxBytes) {
+        QoS qos;
+        qos.history = History::KEEP_ALL;
+        qos.maxBytes = maxBytes;
+        return qos;
+    }
+};
+
+// Msgs of a msg type lost to full queues
+struct QueueStats {
+    uint64_t overwrittenMsgs = 0;
+    uint64_t droppedMsgs = 0;
+};
+
+} // namespace ntwk
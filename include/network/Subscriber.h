@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "Dispatch.h"
+#include "MsgPtr.h"
+#include "MsgTraits.h"
+#include "MsgTypeId.h"
+#include "Node.h"
+#include "QoS.h"
+#include "Topic.h"
+
+namespace ntwk {
+
+// Subscribes to msgs of a single msg table, which handlers get as a ReceivedMsg of that table.
+// Msgs are verified according to the MsgTraits of the table before the handler is called, so
+// it only sees well formed msgs. Subscribing to a topic instead receives the msgs published to
+// that topic, which must be registered with the same msg table if at all. The subscription
+// lasts as long as the Node.
+template<typename Msg, MsgTypeId MSG_TYPE_ID = MsgTraits<Msg>::MSG_TYPE_ID>
+class Subscriber {
+public:
+    static_assert(MsgTraits<Msg>::carries(MSG_TYPE_ID), "The msg type id does not carry the msg");
+
+    using MsgHandler = std::function<void(ReceivedMsg<Msg> &&)>;
+
+    Subscriber(Node &node, const std::string &endpoint, MsgHandler msgHandler,
+               const QoS &qos=QoS(), const Dispatch &dispatch=Dispatch()) :
+        node(node), endpoint(endpoint), msgTypeId(MSG_TYPE_ID) {
+        this->subscribe(std::move(msgHandler), qos, dispatch);
+    }
+
+    Subscriber(Node &node, const std::string &endpoint, const Topic &topic, MsgHandler msgHandler,
+               const QoS &qos=QoS(), const Dispatch &dispatch=Dispatch()) :
+        node(node), endpoint(endpoint), msgTypeId(topic) {
+        registerTopic(topic, MsgTraits<Msg>::getName());
+        this->subscribe(std::move(msgHandler), qos, dispatch);
+    }
+
+    QueueStats getQueueStats() const {
+        return this->node.getQueueStats(this->endpoint, this->msgTypeId);
+    }
+
+    MsgStats getMsgStats() const {
+        return this->node.getMsgStats(this->endpoint, this->msgTypeId);
+    }
+
+private:
+    void subscribe(MsgHandler msgHandler, const QoS &qos, const Dispatch &dispatch) {
+        this->node.subscribeUri(this->endpoint, this->msgTypeId,
+                                [msgHandler=std::move(msgHandler)](MsgPtr &&msg, size_t msgSize) {
+            if (ReceivedMsg<Msg>::verify(msg.get(), msgSize)) {
+                msgHandler(ReceivedMsg<Msg>(std::move(msg), msgSize));
+            }
+        }, qos, dispatch);
+    }
+
+    Node &node;
+    std::string endpoint;
+    MsgTypeId msgTypeId;
+};
+
+} // namespace ntwk
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ntwk {
+
+class Subscription;
+
+// Subscriptions by msg type id, kept in a flat open addressed table that is looked up for every
+// received msg. Ids are spread over the table by multiplicative hashing, which covers both the
+// small built-in msg type ids and hashed topic ids, and the table is kept at most half full.
+class SubscriptionTable {
+public:
+    Subscription *find(uint32_t msgTypeId) const {
+        if (this->entries.empty()) {
+            return nullptr;
+        }
+
+        for (auto slot = this->getSlot(msgTypeId);; slot = (slot + 1) & (this->entries.size() - 1)) {
+            const auto &entry = this->entries[slot];
+            if (!entry.subscription || entry.msgTypeId == msgTypeId) {
+                return entry.subscription.get();
+            }
+        }
+    }
+
+    // Replaces the subscription of the msg type id
+    void insert(uint32_t msgTypeId, std::shared_ptr<Subscription> subscription) {
+        if ((this->count + 1) * 2 > this->entries.size()) {
+            this->grow();
+        }
+
+        for (auto slot = this->getSlot(msgTypeId);; slot = (slot + 1) & (this->entries.size() - 1)) {
+            auto &entry = this->entries[slot];
+            if (!entry.subscription || entry.msgTypeId == msgTypeId) {
+                this->count += entry.subscription ? 0 : 1;
+                entry.msgTypeId = msgTypeId;
+                entry.subscription = std::move(subscription);
+                return;
+            }
+        }
+    }
+
+    void clear() {
+        this->entries.clear();
+        this->count = 0;
+        this->shift = 32;
+    }
+
+private:
+    struct Entry {
+        uint32_t msgTypeId = 0;
+        std::shared_ptr<Subscription> subscription;
+    };
+
+    size_t getSlot(uint32_t msgTypeId) const {
+        // The upper bits of the product are the well mixed ones
+        return static_cast<uint32_t>(msgTypeId * 0x9e3779b1u) >> this->shift;
+    }
+
+    void grow() {
+        auto oldEntries = std::move(this->entries);
+        --this->shift;
+        if (oldEntries.empty()) {
+            this->shift = 32 - 3;
+        }
+        this->entries = std::vector<Entry>(size_t(1) << (32 - this->shift));
+        this->count = 0;
+        for (auto &entry : oldEntries) {
+            if (entry.subscription) {
+                this->insert(entry.msgTypeId, std::move(entry.subscription));
+            }
+        }
+    }
+
+    std::vector<Entry> entries;
+    size_t count = 0;
+    unsigned int shift = 32;
+};
+
+} // namespace ntwk
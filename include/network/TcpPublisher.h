@@ -1,40 +1,103 @@
 #pragma once
 
+#include <cstdint>
+#include <future>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
-#include <asio/ip/tcp.hpp>
 #include <asio/io_context.hpp>
+#include <asio/strand.hpp>
 #include <flatbuffers/flatbuffers.h>
 
+#include "Metrics.h"
 #include "MsgTypeId.h"
+#include "QoS.h"
+#include "Transport.h"
 
 namespace ntwk {
 
+class IntraProcessChannel;
+class SharedMemorySegment;
+struct ConnectionCounters;
+struct MsgHeader;
+struct SharedMemoryMsg;
+struct TopicCounters;
+
 class TcpPublisher : public std::enable_shared_from_this<TcpPublisher> {
 private:
     struct Socket;
     using SocketPtr = std::shared_ptr<Socket>;
     using PublisherPtr = std::shared_ptr<ntwk::TcpPublisher>;
+    using Strand = transport::Strand;
 
 public:
     static std::shared_ptr<TcpPublisher> create(asio::io_context &publisherContext,
-                                                unsigned short port);
+                                                const std::string &endpoint, unsigned int windowSize);
+    ~TcpPublisher();
 
     void publish(MsgTypeId msgTypeId, std::shared_ptr<flatbuffers::DetachedBuffer> msg);
 
+    // Queueing of msgs waiting to be sent to each socket
+    void setQoS(MsgTypeId msgTypeId, const QoS &qos);
+    QueueStats getQueueStats(MsgTypeId msgTypeId) const;
+
+    PublisherMetrics getMetrics() const;
+
+    // Stops accepting connections and disconnects the connected sockets, which are all
+    // disconnected once the future is ready
+    std::future<void> close();
+
 private:
-    TcpPublisher(asio::io_context &publisherContext, unsigned short port);
+    TcpPublisher(asio::io_context &publisherContext, const std::string &endpoint,
+                 unsigned int windowSize);
 
     void listenForConnections();
-    static void sendMsg(PublisherPtr &&publisher, SocketPtr &&socket,
-                        ntwk::MsgTypeId msgTypeId);
+    static void sendHandshake(PublisherPtr &&publisher, SocketPtr &&socket);
+    static void receiveHandshake(PublisherPtr &&publisher, SocketPtr &&socket);
+    static void offerSharedMemory(PublisherPtr &&publisher, SocketPtr &&socket);
+    static void addConnectedSocket(PublisherPtr &&publisher, SocketPtr &&socket);
+
+    static void sendMsg(const PublisherPtr &publisher, const SocketPtr &socket);
+    static void receiveAck(PublisherPtr &&publisher, SocketPtr &&socket);
+    static void receiveCtrl(PublisherPtr &&publisher, SocketPtr &&socket);
+    static void receiveSubscription(PublisherPtr &&publisher, SocketPtr &&socket);
+    void disconnect(const SocketPtr &socket);
+
+    bool acquireSharedMemoryHolder(Socket &socket);
+    void reclaimSharedMemoryHolders();
+    std::shared_ptr<SharedMemoryMsg> copyToSharedMemory(const MsgHeader &msgHeader,
+                                                        const flatbuffers::DetachedBuffer &msg);
+    TopicCounters &getTopicCounters(MsgTypeId msgTypeId);
 
 private:
+    // Accepting connections and fanning out msgs to the connected sockets runs on the
+    // publisher's strand, sockets send on their own strands
     asio::io_context &publisherContext;
-    asio::ip::tcp::acceptor socketAcceptor;
+    Strand strand;
+    transport::Endpoint endpoint;
+    transport::Acceptor socketAcceptor;
+    unsigned int windowSize;
 
     std::list<SocketPtr> connectedSockets;
+    std::shared_ptr<IntraProcessChannel> intraProcessChannel;
+
+    // Holders of connected subscribers, and of disconnected subscribers whose msgs may still
+    // release their slots
+    std::shared_ptr<SharedMemorySegment> sharedMemory;
+    uint64_t sharedMemoryHolders;
+    uint64_t detachedSharedMemoryHolders;
+
+    // Publisher's strand: sequence number of the next msg of each msg type
+    std::unordered_map<MsgTypeId, uint64_t> sequenceNumbers;
+
+    std::unordered_map<MsgTypeId, QoS> qos;
+
+    // Counters are only added on the publisher's strand, which looks them up without the lock
+    mutable std::mutex metricsMutex;
+    std::unordered_map<MsgTypeId, std::unique_ptr<TopicCounters>> topicCounters;
+    std::list<std::shared_ptr<ConnectionCounters>> connectionCounters;
 };
 
 } // namespace ntwk
@@ -1,56 +1,149 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
 
-#include <asio/ip/tcp.hpp>
 #include <asio/steady_timer.hpp>
+#include <asio/strand.hpp>
 
+#include "Dispatch.h"
+#include "HandlerMemory.h"
+#include "Metrics.h"
+#include "MsgPtr.h"
+#include "MsgStats.h"
 #include "MsgTypeId.h"
+#include "QoS.h"
+#include "SubscriptionTable.h"
+#include "Transport.h"
+#include "msgs/Header_generated.h"
+#include "msgs/MsgCtrl_generated.h"
+#include "msgs/MsgStamp_generated.h"
 
 namespace ntwk {
 
-class TcpSubscriber {
+class IntraProcessChannel;
+class MsgStatsRecorder;
+class ReceiveBufferPool;
+class SharedMemorySegment;
+struct ConnectionCounters;
+struct TopicCounters;
+
+class TcpSubscriber : public std::enable_shared_from_this<TcpSubscriber> {
 private:
+    using Strand = transport::Strand;
     using MsgTypeIdUnderlyingType = std::underlying_type_t<MsgTypeId>;
-    using MsgPtr = std::unique_ptr<uint8_t[]>;
-    using MsgBufferMap = std::unordered_map<MsgTypeIdUnderlyingType, MsgPtr>;
 
     using MsgHandler = std::function<void(MsgPtr &&)>;
-    using MsgHandlerMap = std::unordered_map<MsgTypeIdUnderlyingType, MsgHandler>;
+    using SizedMsgHandler = std::function<void(MsgPtr &&, size_t)>;
 
 public:
-    static std::shared_ptr<TcpSubscriber> create(asio::io_context &mainContext,
-                                                 asio::io_context &subscriberContext,
-                                                 const std::string &host, unsigned short port);
-
-    void subscribe(MsgTypeId msgTypeId, MsgHandler msgHandler);
+    static std::shared_ptr<TcpSubscriber> create(const std::shared_ptr<asio::io_context> &mainContext,
+                                                 const std::shared_ptr<asio::io_context> &subscriberContext,
+                                                 const std::string &endpoint);
+
+    void subscribe(MsgTypeId msgTypeId, MsgHandler msgHandler, const QoS &qos=QoS(),
+                   const Dispatch &dispatch=Dispatch());
+    void subscribe(MsgTypeId msgTypeId, SizedMsgHandler msgHandler, const QoS &qos=QoS(),
+                   const Dispatch &dispatch=Dispatch());
+    QueueStats getQueueStats(MsgTypeId msgTypeId) const;
+    MsgStats getMsgStats(MsgTypeId msgTypeId) const;
+    SubscriberMetrics getMetrics() const;
+
+    // Disconnects from the publisher and stops reconnecting. Msgs are no longer handed to the
+    // subscriptions once the future is ready.
+    std::future<void> close();
 
 private:
-    TcpSubscriber(asio::io_context &mainContext,
-                  asio::io_context &subscriberContext,
-                  const std::string &host, unsigned short port);
+    TcpSubscriber(const std::shared_ptr<asio::io_context> &mainContext,
+                  const std::shared_ptr<asio::io_context> &subscriberContext,
+                  const std::string &endpoint);
 
     static void connect(std::shared_ptr<TcpSubscriber> subscriber);
+    static bool connectIntraProcess(const std::shared_ptr<TcpSubscriber> &subscriber);
+
+    static void reconnect(std::shared_ptr<TcpSubscriber> &&subscriber);
 
     static void receiveMsg(std::shared_ptr<TcpSubscriber> &&subscriber);
+    static void receiveMsgData(std::shared_ptr<TcpSubscriber> &&subscriber);
+
+    static void acceptHandshake(std::shared_ptr<TcpSubscriber> &&subscriber, const uint8_t msg[]);
+    static void acceptCtrlMsg(const std::shared_ptr<TcpSubscriber> &subscriber, const uint8_t msg[]);
+    MsgPtr receiveSharedMemoryMsg(const uint8_t msg[], uint32_t &msgSize);
+
+    static void acknowledgeMsg(std::shared_ptr<TcpSubscriber> &&subscriber);
+    void queueCtrl(const msgs::Ctrl &ctrl);
+    void queueSubscription();
+    static void sendCtrl(std::shared_ptr<TcpSubscriber> subscriber);
+
+    static void enqueueMsg(const std::shared_ptr<TcpSubscriber> &subscriber,
+                           MsgTypeIdUnderlyingType msgTypeId, MsgPtr &&msg, size_t msgSize,
+                           const msgs::MsgStamp *msgStamp);
 
-    static void postMsgHandlingTask(std::shared_ptr<TcpSubscriber> &&subscriber,
-                                    MsgTypeIdUnderlyingType msgTypeId);
 
 private:
-    asio::io_context &mainContext;
-    asio::io_context &subscriberContext;
+    // Subscriptions hand msgs to the main context of the Node for as long as it exists
+    std::weak_ptr<asio::io_context> mainContext;
 
-    asio::ip::tcp::socket socket;
-    std::unique_ptr<asio::steady_timer> socketReconnectTimer;
-    asio::ip::tcp::endpoint endpoint;
+    // The connection is served on its own strand of the subscriber context
+    Strand strand;
+    std::weak_ptr<asio::io_context> weakSubscriberContext;
 
-    MsgHandlerMap msgHandlers;
-    MsgBufferMap msgBuffers;
+    transport::Socket socket;
+    std::unique_ptr<asio::steady_timer> socketReconnectTimer;
+    HandlerMemory handlerMemory;
+    transport::Endpoint endpoint;
+    bool closed;
+
+    msgs::Header msgHeader;
+    msgs::MsgStamp msgStamp;
+    std::shared_ptr<ReceiveBufferPool> receiveBuffers;
+    msgs::Ctrl ctrl;
+
+    // Msg handlers of the subscribed msg types, kept on the subscriber's strand
+    SubscriptionTable subscriptions;
+
+    // Stats and counters of the msg types outlive the subscriptions replacing each other, the
+    // subscriptions update them without the lock
+    mutable std::mutex statsMutex;
+    std::unordered_map<MsgTypeIdUnderlyingType, std::shared_ptr<MsgStatsRecorder>> msgStats;
+    std::unordered_map<MsgTypeIdUnderlyingType, std::shared_ptr<TopicCounters>> topicCounters;
+    std::shared_ptr<ConnectionCounters> connectionCounters;
+    uint64_t sendStartTime;
+
+    // Counts connections, as sequence numbers are only compared within a connection. The port
+    // of the connection's socket tells its msgs apart from those of other connections in traces.
+    uint64_t connection;
+    uint16_t connectionPort;
+
+    // Msg types with a handler, kept on the subscriber context to tell the publisher
+    std::set<MsgTypeIdUnderlyingType> subscribedMsgTypeIds;
+
+    // Flow control negotiated in the handshake. Acks are coalesced into a single
+    // cumulative ack every ackInterval msgs or whenever no more msgs are pending.
+    uint32_t protocolVersion;
+    bool handshakePending;
+    unsigned int ackInterval;
+    unsigned int unackedMsgs;
+
+    // Ctrl msgs queued for the publisher, sent together with pending acks
+    std::vector<uint8_t> pendingCtrl;
+    std::vector<uint8_t> sendingCtrlBuffer;
+    bool sendingCtrl;
+
+    std::shared_ptr<SharedMemorySegment> sharedMemory;
+    unsigned int sharedMemoryHolder;
+
+    // Channel of a publisher in the same process, told of the subscribed msg types as well
+    std::weak_ptr<IntraProcessChannel> intraProcessChannel;
+    uint64_t intraProcessSubscriberId;
 };
 
 } // namespace ntwk
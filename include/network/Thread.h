@@ -22,6 +22,9 @@ public:
 
     void stop();
 
+    // Restricts the thread to run on the given CPU
+    void setCpuAffinity(unsigned int cpu);
+
     template<typename Func>
     void post(Func &&f);
 
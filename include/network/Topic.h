@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+#include "MsgTypeId.h"
+
+namespace ntwk {
+
+// Named stream of msgs such as "/cam/front". Publishers multiplex any number of topics over
+// their connections, including several topics of the same msg table. A topic travels on the
+// wire as a 32 bit id hashed from its name, computed at compile time for constant names, and
+// converts to the msg type id Nodes publish and subscribe with. Topic ids have bit 30 set and
+// the top bit clear, so they never collide with the built-in msg type ids.
+class Topic {
+public:
+    // The name must outlive the topic
+    constexpr explicit Topic(const char *name) : name(name), id(hashName(name)) { }
+
+    constexpr const char *getName() const {
+        return this->name;
+    }
+
+    constexpr MsgTypeId getId() const {
+        return this->id;
+    }
+
+    constexpr operator MsgTypeId() const {
+        return this->id;
+    }
+
+private:
+    // 32 bit FNV-1a
+    static constexpr MsgTypeId hashName(const char *name) {
+        uint32_t hash = 0x811c9dc5;
+        for (; *name; ++name) {
+            hash = (hash ^ static_cast<uint8_t>(*name)) * 0x01000193;
+        }
+        return static_cast<MsgTypeId>((hash & 0x3fffffff) | 0x40000000);
+    }
+
+    const char *name;
+    MsgTypeId id;
+};
+
+// Records the topic's name for its id in the process, throwing if a different name hashes
+// to the same id. The msg table of the topic is recorded as well when given, as typed
+// publishers and subscribers do, throwing if the topic was registered with another one.
+// Nodes register the topics they publish and subscribe to.
+void registerTopic(const Topic &topic, const char *msgTableName=nullptr);
+
+} // namespace ntwk
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <ostream>
+
+namespace ntwk {
+namespace trace {
+
+// Whether the library was built with the NETWORK_TRACING option. Without it, the lifecycle of
+// msgs is not recorded at all and traces are empty.
+bool isEnabled();
+
+// Writes the events recorded by all threads of the process since the previous trace as Chrome
+// trace event JSON, which chrome://tracing and the Perfetto UI open. Each msg published through
+// a socket gets its own track for each connection, keyed by its msg type id, sequence number
+// and the port of the subscriber's socket, so traces of publishers and subscribers on the same
+// host line up when their traceEvents are merged.
+void writeChromeTrace(std::ostream &stream);
+
+} // namespace trace
+} // namespace ntwk
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+
+#include <asio/basic_datagram_socket.hpp>
+#include <asio/basic_socket_acceptor.hpp>
+#include <asio/basic_stream_socket.hpp>
+#include <asio/generic/stream_protocol.hpp>
+#include <asio/io_context.hpp>
+#include <asio/ip/udp.hpp>
+#include <asio/strand.hpp>
+
+namespace ntwk {
+namespace transport {
+
+// Publishers and subscribers work on generic stream sockets so the same protocol runs over
+// TCP ("tcp://host:port" or "host:port") and Unix domain sockets ("unix:///path/to/socket").
+// Sockets are bound to the strand serving their connection by type rather than through a
+// type-erased executor, which would allocate for every operation started on them.
+using Protocol = asio::generic::stream_protocol;
+using Endpoint = Protocol::endpoint;
+using Strand = asio::strand<asio::io_context::executor_type>;
+using Socket = asio::basic_stream_socket<Protocol, Strand>;
+using Acceptor = asio::basic_socket_acceptor<Protocol>;
+
+Endpoint makeEndpoint(const std::string &uri);
+std::string makeUri(const std::string &host, unsigned short port);
+
+// Multicast groups are given as "udp://group:port"
+using MulticastSocket = asio::basic_datagram_socket<asio::ip::udp, Strand>;
+
+bool isMulticast(const std::string &uri);
+asio::ip::udp::endpoint makeMulticastEndpoint(const std::string &uri);
+
+// Whether the endpoint is on the same host: Unix domain sockets, loopback addresses and the
+// addresses of the host's interfaces, as assigned when called. Host names are not resolved.
+bool isLocal(const Endpoint &endpoint);
+
+// Port of a TCP endpoint, 0 for Unix domain sockets
+unsigned short getPort(const Endpoint &endpoint);
+
+// Uri of the endpoint, empty for unnamed Unix domain sockets
+std::string getUri(const Endpoint &endpoint);
+
+// Name shared by publishers and subscribers of the endpoint within the same process
+std::string getLocalName(const Endpoint &endpoint);
+
+Acceptor makeAcceptor(const Strand &strand, const Endpoint &endpoint);
+void configure(Socket &socket);
+void remove(const Endpoint &endpoint);
+
+} // namespace transport
+} // namespace ntwk
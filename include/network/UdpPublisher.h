@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <asio/io_context.hpp>
+#include <asio/ip/udp.hpp>
+#include <asio/strand.hpp>
+#include <flatbuffers/flatbuffers.h>
+
+#include "HandlerMemory.h"
+#include "MsgQueue.h"
+#include "MsgTypeId.h"
+#include "QoS.h"
+#include "Transport.h"
+#include "msgs/MulticastFragment_generated.h"
+
+namespace ntwk {
+
+// Publishes msgs to a multicast group with a single send per fragment regardless of the
+// number of subscribers. Delivery is best effort: pending msgs are queued according to the QoS
+// of their type and subscribers detect lost msgs from gaps in the msg sequence numbers.
+class UdpPublisher : public std::enable_shared_from_this<UdpPublisher> {
+private:
+    using PublisherPtr = std::shared_ptr<ntwk::UdpPublisher>;
+    using Strand = transport::Strand;
+    using MsgMap = std::unordered_map<MsgTypeId, MsgQueue<std::shared_ptr<flatbuffers::DetachedBuffer>>>;
+
+public:
+    static std::shared_ptr<UdpPublisher> create(asio::io_context &publisherContext,
+                                                const std::string &endpoint);
+
+    void publish(MsgTypeId msgTypeId, std::shared_ptr<flatbuffers::DetachedBuffer> msg);
+
+    void setQoS(MsgTypeId msgTypeId, const QoS &qos);
+    QueueStats getQueueStats(MsgTypeId msgTypeId) const;
+
+    // Discards the msgs waiting to be sent, which is done once the future is ready
+    std::future<void> close();
+
+private:
+    UdpPublisher(asio::io_context &publisherContext, const std::string &endpoint);
+
+    static void sendMsg(PublisherPtr &&publisher);
+
+private:
+    Strand strand;
+    asio::ip::udp::endpoint endpoint;
+    transport::MulticastSocket socket;
+    HandlerMemory handlerMemory;
+
+    MsgMap msgs;
+    std::deque<MsgTypeId> pendingMsgTypeIds;
+
+    // Msgs are sent by a single chain of sends, which runs until no msgs are pending
+    bool sending;
+    std::shared_ptr<flatbuffers::DetachedBuffer> sendingMsg;
+    msgs::MulticastFragment fragment;
+    uint32_t sequence;
+
+    mutable std::mutex queueStatsMutex;
+    std::unordered_map<MsgTypeId, QueueStats> queueStats;
+};
+
+} // namespace ntwk
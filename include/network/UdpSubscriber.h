@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <asio/io_context.hpp>
+#include <asio/strand.hpp>
+#include <asio/ip/udp.hpp>
+
+#include "Dispatch.h"
+#include "HandlerMemory.h"
+#include "MsgPtr.h"
+#include "MsgTypeId.h"
+#include "QoS.h"
+#include "SubscriptionTable.h"
+#include "Transport.h"
+#include "msgs/MulticastFragment_generated.h"
+
+namespace ntwk {
+
+class ReceiveBufferPool;
+
+// Receives msgs published to a multicast group by UdpPublishers. Msgs are reassembled from
+// their fragments and lost msgs are counted from the first msg received, for each publisher.
+class UdpSubscriber : public std::enable_shared_from_this<UdpSubscriber> {
+private:
+    using Strand = transport::Strand;
+    using MsgTypeIdUnderlyingType = std::underlying_type_t<MsgTypeId>;
+
+    using MsgHandler = std::function<void(MsgPtr &&)>;
+    using SizedMsgHandler = std::function<void(MsgPtr &&, size_t)>;
+
+public:
+    static std::shared_ptr<UdpSubscriber> create(const std::shared_ptr<asio::io_context> &mainContext,
+                                                 const std::shared_ptr<asio::io_context> &subscriberContext,
+                                                 const std::string &endpoint);
+
+    void subscribe(MsgTypeId msgTypeId, MsgHandler msgHandler, const QoS &qos=QoS(),
+                   const Dispatch &dispatch=Dispatch());
+    void subscribe(MsgTypeId msgTypeId, SizedMsgHandler msgHandler, const QoS &qos=QoS(),
+                   const Dispatch &dispatch=Dispatch());
+    QueueStats getQueueStats(MsgTypeId msgTypeId) const;
+
+    uint64_t getLostMsgCount() const;
+
+    // Leaves the multicast group. Msgs are no longer handed to the subscriptions once the future
+    // is ready.
+    std::future<void> close();
+
+private:
+    UdpSubscriber(const std::shared_ptr<asio::io_context> &mainContext,
+                  const std::shared_ptr<asio::io_context> &subscriberContext,
+                  const std::string &endpoint);
+
+    static void receiveFragment(std::shared_ptr<UdpSubscriber> &&subscriber);
+    MsgPtr acceptFragment(size_t datagramSize, msgs::MulticastFragment &fragment);
+
+    static void enqueueMsg(const std::shared_ptr<UdpSubscriber> &subscriber,
+                           MsgTypeIdUnderlyingType msgTypeId, MsgPtr &&msg, size_t msgSize);
+
+
+private:
+    // Msg being reassembled from a publisher. The fragments of a msg are sent back to back, so
+    // a fragment other than the next one of the same msg means the rest of the msg was lost.
+    struct Reassembly {
+        msgs::MulticastFragment fragment;
+        MutableMsgPtr msg;
+        uint32_t receivedSize = 0;
+
+        bool receivedFirstMsg = false;
+        uint32_t nextSequence = 0;
+    };
+
+    // Subscriptions hand msgs to the main context of the Node for as long as it exists
+    std::weak_ptr<asio::io_context> mainContext;
+
+    // The connection is served on its own strand of the subscriber context
+    Strand strand;
+
+    transport::MulticastSocket socket;
+    HandlerMemory handlerMemory;
+    std::vector<uint8_t> datagram;
+    asio::ip::udp::endpoint datagramSender;
+
+    // Msg handlers of the subscribed msg types, kept on the subscriber's strand
+    SubscriptionTable subscriptions;
+
+    mutable std::mutex queueStatsMutex;
+    std::unordered_map<MsgTypeIdUnderlyingType, QueueStats> queueStats;
+
+    // Publishers to the same group number their msgs independently
+    std::map<asio::ip::udp::endpoint, Reassembly> reassemblies;
+    std::shared_ptr<ReceiveBufferPool> receiveBuffers;
+    std::atomic<uint64_t> lostMsgs;
+};
+
+} // namespace ntwk
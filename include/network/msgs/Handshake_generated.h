@@ -0,0 +1,38 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+
+#ifndef FLATBUFFERS_GENERATED_HANDSHAKE_MSGS_H_
+#define FLATBUFFERS_GENERATED_HANDSHAKE_MSGS_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace msgs {
+
+struct Handshake;
+
+FLATBUFFERS_MANUALLY_ALIGNED_STRUCT(4) Handshake FLATBUFFERS_FINAL_CLASS {
+ private:
+  uint32_t version_;
+  uint32_t window_size_;
+
+ public:
+  Handshake()
+      : version_(0),
+        window_size_(0) {
+  }
+  Handshake(uint32_t _version, uint32_t _window_size)
+      : version_(flatbuffers::EndianScalar(_version)),
+        window_size_(flatbuffers::EndianScalar(_window_size)) {
+  }
+  uint32_t version() const {
+    return flatbuffers::EndianScalar(version_);
+  }
+  uint32_t window_size() const {
+    return flatbuffers::EndianScalar(window_size_);
+  }
+};
+FLATBUFFERS_STRUCT_END(Handshake, 8);
+
+}  // namespace msgs
+
+#endif  // FLATBUFFERS_GENERATED_HANDSHAKE_MSGS_H_
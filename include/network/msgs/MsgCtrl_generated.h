@@ -8,33 +8,85 @@
 
 namespace msgs {
 
+struct Ctrl;
+
 enum class MsgCtrl : uint8_t {
+  NONE = 0,
   ACK = 1,
-  MIN = ACK,
-  MAX = ACK
+  HANDSHAKE = 2,
+  ACK_CUMULATIVE = 3,
+  SHARED_MEMORY_SEGMENT = 4,
+  SHARED_MEMORY_ATTACHED = 5,
+  SUBSCRIBE = 6,
+  MIN = NONE,
+  MAX = SUBSCRIBE
 };
 
-inline const MsgCtrl (&EnumValuesMsgCtrl())[1] {
+inline const MsgCtrl (&EnumValuesMsgCtrl())[7] {
   static const MsgCtrl values[] = {
-    MsgCtrl::ACK
+    MsgCtrl::NONE,
+    MsgCtrl::ACK,
+    MsgCtrl::HANDSHAKE,
+    MsgCtrl::ACK_CUMULATIVE,
+    MsgCtrl::SHARED_MEMORY_SEGMENT,
+    MsgCtrl::SHARED_MEMORY_ATTACHED,
+    MsgCtrl::SUBSCRIBE
   };
   return values;
 }
 
 inline const char * const *EnumNamesMsgCtrl() {
-  static const char * const names[2] = {
+  static const char * const names[8] = {
+    "NONE",
     "ACK",
+    "HANDSHAKE",
+    "ACK_CUMULATIVE",
+    "SHARED_MEMORY_SEGMENT",
+    "SHARED_MEMORY_ATTACHED",
+    "SUBSCRIBE",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameMsgCtrl(MsgCtrl e) {
-  if (flatbuffers::IsOutRange(e, MsgCtrl::ACK, MsgCtrl::ACK)) return "";
-  const size_t index = static_cast<size_t>(e) - static_cast<size_t>(MsgCtrl::ACK);
+  if (flatbuffers::IsOutRange(e, MsgCtrl::NONE, MsgCtrl::SUBSCRIBE)) return "";
+  const size_t index = static_cast<size_t>(e);
   return EnumNamesMsgCtrl()[index];
 }
 
+FLATBUFFERS_MANUALLY_ALIGNED_STRUCT(4) Ctrl FLATBUFFERS_FINAL_CLASS {
+ private:
+  uint8_t ctrl_;
+  int8_t padding0__;  int16_t padding1__;
+  uint32_t value_;
+
+ public:
+  Ctrl()
+      : ctrl_(0),
+        padding0__(0),
+        padding1__(0),
+        value_(0) {
+    (void)padding0__;
+    (void)padding1__;
+  }
+  Ctrl(msgs::MsgCtrl _ctrl, uint32_t _value)
+      : ctrl_(flatbuffers::EndianScalar(static_cast<uint8_t>(_ctrl))),
+        padding0__(0),
+        padding1__(0),
+        value_(flatbuffers::EndianScalar(_value)) {
+    (void)padding0__;
+    (void)padding1__;
+  }
+  msgs::MsgCtrl ctrl() const {
+    return static_cast<msgs::MsgCtrl>(flatbuffers::EndianScalar(ctrl_));
+  }
+  uint32_t value() const {
+    return flatbuffers::EndianScalar(value_);
+  }
+};
+FLATBUFFERS_STRUCT_END(Ctrl, 8);
+
 }  // namespace msgs
 
 #endif  // FLATBUFFERS_GENERATED_MSGCTRL_MSGS_H_
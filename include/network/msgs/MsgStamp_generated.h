@@ -0,0 +1,38 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+
+#ifndef FLATBUFFERS_GENERATED_MSGSTAMP_MSGS_H_
+#define FLATBUFFERS_GENERATED_MSGSTAMP_MSGS_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace msgs {
+
+struct MsgStamp;
+
+FLATBUFFERS_MANUALLY_ALIGNED_STRUCT(8) MsgStamp FLATBUFFERS_FINAL_CLASS {
+ private:
+  uint64_t publish_time_;
+  uint64_t sequence_;
+
+ public:
+  MsgStamp()
+      : publish_time_(0),
+        sequence_(0) {
+  }
+  MsgStamp(uint64_t _publish_time, uint64_t _sequence)
+      : publish_time_(flatbuffers::EndianScalar(_publish_time)),
+        sequence_(flatbuffers::EndianScalar(_sequence)) {
+  }
+  uint64_t publish_time() const {
+    return flatbuffers::EndianScalar(publish_time_);
+  }
+  uint64_t sequence() const {
+    return flatbuffers::EndianScalar(sequence_);
+  }
+};
+FLATBUFFERS_STRUCT_END(MsgStamp, 16);
+
+}  // namespace msgs
+
+#endif  // FLATBUFFERS_GENERATED_MSGSTAMP_MSGS_H_
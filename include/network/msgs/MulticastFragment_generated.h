@@ -0,0 +1,50 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+
+#ifndef FLATBUFFERS_GENERATED_MULTICASTFRAGMENT_MSGS_H_
+#define FLATBUFFERS_GENERATED_MULTICASTFRAGMENT_MSGS_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace msgs {
+
+struct MulticastFragment;
+
+FLATBUFFERS_MANUALLY_ALIGNED_STRUCT(4) MulticastFragment FLATBUFFERS_FINAL_CLASS {
+ private:
+  uint32_t msg_type_id_;
+  uint32_t sequence_;
+  uint32_t msg_size_;
+  uint32_t offset_;
+
+ public:
+  MulticastFragment()
+      : msg_type_id_(0),
+        sequence_(0),
+        msg_size_(0),
+        offset_(0) {
+  }
+  MulticastFragment(uint32_t _msg_type_id, uint32_t _sequence, uint32_t _msg_size, uint32_t _offset)
+      : msg_type_id_(flatbuffers::EndianScalar(_msg_type_id)),
+        sequence_(flatbuffers::EndianScalar(_sequence)),
+        msg_size_(flatbuffers::EndianScalar(_msg_size)),
+        offset_(flatbuffers::EndianScalar(_offset)) {
+  }
+  uint32_t msg_type_id() const {
+    return flatbuffers::EndianScalar(msg_type_id_);
+  }
+  uint32_t sequence() const {
+    return flatbuffers::EndianScalar(sequence_);
+  }
+  uint32_t msg_size() const {
+    return flatbuffers::EndianScalar(msg_size_);
+  }
+  uint32_t offset() const {
+    return flatbuffers::EndianScalar(offset_);
+  }
+};
+FLATBUFFERS_STRUCT_END(MulticastFragment, 16);
+
+}  // namespace msgs
+
+#endif  // FLATBUFFERS_GENERATED_MULTICASTFRAGMENT_MSGS_H_
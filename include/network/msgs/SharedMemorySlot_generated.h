@@ -0,0 +1,38 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+
+#ifndef FLATBUFFERS_GENERATED_SHAREDMEMORYSLOT_MSGS_H_
+#define FLATBUFFERS_GENERATED_SHAREDMEMORYSLOT_MSGS_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace msgs {
+
+struct SharedMemorySlot;
+
+FLATBUFFERS_MANUALLY_ALIGNED_STRUCT(4) SharedMemorySlot FLATBUFFERS_FINAL_CLASS {
+ private:
+  uint32_t slot_;
+  uint32_t msg_size_;
+
+ public:
+  SharedMemorySlot()
+      : slot_(0),
+        msg_size_(0) {
+  }
+  SharedMemorySlot(uint32_t _slot, uint32_t _msg_size)
+      : slot_(flatbuffers::EndianScalar(_slot)),
+        msg_size_(flatbuffers::EndianScalar(_msg_size)) {
+  }
+  uint32_t slot() const {
+    return flatbuffers::EndianScalar(slot_);
+  }
+  uint32_t msg_size() const {
+    return flatbuffers::EndianScalar(msg_size_);
+  }
+};
+FLATBUFFERS_STRUCT_END(SharedMemorySlot, 8);
+
+}  // namespace msgs
+
+#endif  // FLATBUFFERS_GENERATED_SHAREDMEMORYSLOT_MSGS_H_
@@ -0,0 +1,55 @@
+#include "BufferPool.h"
+
+namespace {
+
+constexpr size_t MIN_BUFFER_SIZE = 1024;
+constexpr size_t MAX_FREE_BUFFERS_PER_SIZE_CLASS = 4;
+
+size_t getSizeClass(size_t size) {
+    size_t sizeClass = 0;
+    while ((MIN_BUFFER_SIZE << sizeClass) < size) {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+} // namespace
+
+namespace ntwk {
+
+BufferPool &BufferPool::get() {
+    static auto bufferPool = new BufferPool();
+    return *bufferPool;
+}
+
+uint8_t *BufferPool::allocate(size_t size) {
+    const auto sizeClass = getSizeClass(size);
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (sizeClass < this->freeBuffers.size() && !this->freeBuffers[sizeClass].empty()) {
+            auto buffer = this->freeBuffers[sizeClass].back();
+            this->freeBuffers[sizeClass].pop_back();
+            return buffer;
+        }
+    }
+    return new uint8_t[MIN_BUFFER_SIZE << sizeClass];
+}
+
+void BufferPool::deallocate(uint8_t *buffer, size_t size) {
+    // Buffers are freed with the size they were allocated with, which maps to the same class
+    const auto sizeClass = getSizeClass(size);
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (sizeClass >= this->freeBuffers.size()) {
+            this->freeBuffers.resize(sizeClass + 1);
+        }
+        auto &buffers = this->freeBuffers[sizeClass];
+        if (buffers.size() < MAX_FREE_BUFFERS_PER_SIZE_CLASS) {
+            buffers.push_back(buffer);
+            return;
+        }
+    }
+    delete[] buffer;
+}
+
+} // namespace ntwk
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <flatbuffers/flatbuffers.h>
+
+namespace ntwk {
+
+// Memory for building msgs, shared by the whole process. Freed buffers are kept in power of two
+// size classes and reused for the next buffers of similar size, so building large msgs such as
+// images at a steady rate neither allocates nor faults in fresh pages. Builders using the pool
+// release their msgs into DetachedBuffers that return their memory once the last reference to
+// them is gone, which is after every subscriber has been sent the msg, on whichever thread that
+// happens.
+class BufferPool : public flatbuffers::Allocator {
+public:
+    // Outlives all buffers, including those released during static destruction
+    static BufferPool &get();
+
+    BufferPool(const BufferPool &other) = delete;
+    BufferPool &operator=(const BufferPool &other) = delete;
+
+    uint8_t *allocate(size_t size) override;
+    void deallocate(uint8_t *buffer, size_t size) override;
+
+private:
+    BufferPool() = default;
+
+    std::mutex mutex;
+    std::vector<std::vector<uint8_t *>> freeBuffers;
+};
+
+} // namespace ntwk
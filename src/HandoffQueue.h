@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace ntwk {
+
+// Bounded lock-free queue handing msgs from the network threads to the main context. Each
+// slot carries a sequence number telling producers and consumers whether it is free or
+// filled, so both sides only contend on their own position. A producer may also pop, which
+// lets it overwrite the oldest msg when the queue is full.
+template<typename T>
+class HandoffQueue {
+public:
+    explicit HandoffQueue(size_t capacity);
+
+    HandoffQueue(const HandoffQueue &other) = delete;
+    HandoffQueue &operator=(const HandoffQueue &other) = delete;
+
+    // The value is only moved from if there was room for it
+    bool push(T &&value);
+    bool pop(T &value);
+
+    size_t capacity() const {
+        return this->maxSize;
+    }
+
+    // Only a hint while msgs are pushed or popped concurrently
+    bool empty() const {
+        return this->head.load(std::memory_order_acquire) == this->tail.load(std::memory_order_acquire);
+    }
+
+    // Only a hint as well. A push may also fail while the queue is not full, when a consumer
+    // has taken the slot's position but not yet moved the value out of it.
+    bool full() const {
+        const auto position = this->head.load(std::memory_order_acquire);
+        return this->tail.load(std::memory_order_acquire) - position >= this->maxSize;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Sequence numbers only tell a filled slot from a free one with at least two slots
+    std::unique_ptr<Slot[]> slots;
+    size_t slotCount;
+    size_t maxSize;
+    std::atomic<size_t> tail;
+    std::atomic<size_t> head;
+};
+
+template<typename T>
+HandoffQueue<T>::HandoffQueue(size_t capacity) :
+    slots(new Slot[std::max<size_t>(capacity, 2)]), slotCount(std::max<size_t>(capacity, 2)),
+    maxSize(std::max<size_t>(capacity, 1)), tail(0), head(0) {
+    for (size_t i = 0; i < this->slotCount; ++i) {
+        this->slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+bool HandoffQueue<T>::push(T &&value) {
+    auto position = this->tail.load(std::memory_order_relaxed);
+    for (;;) {
+        auto &slot = this->slots[position % this->slotCount];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (diff == 0) {
+            if (position - this->head.load(std::memory_order_acquire) >= this->maxSize) {
+                return false;
+            }
+            if (this->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.value = std::move(value);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // The slot still holds the msg pushed a lap earlier
+            return false;
+        } else {
+            position = this->tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<typename T>
+bool HandoffQueue<T>::pop(T &value) {
+    auto position = this->head.load(std::memory_order_relaxed);
+    for (;;) {
+        auto &slot = this->slots[position % this->slotCount];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+        if (diff == 0) {
+            if (this->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                value = std::move(slot.value);
+                slot.sequence.store(position + this->slotCount, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // The slot has not been filled yet
+            return false;
+        } else {
+            position = this->head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace ntwk
@@ -5,6 +5,8 @@
 
 #include <network/msgs/Image_generated.h>
 
+#include "BufferPool.h"
+
 namespace ntwk {
 
 Image::Image(unsigned int width, unsigned int height, uint8_t channels,
@@ -13,12 +15,9 @@ Image::Image(unsigned int width, unsigned int height, uint8_t channels,
 
 std::shared_ptr<flatbuffers::DetachedBuffer> Image::makeBuffer(unsigned int width, unsigned int height,
                                                                uint8_t channels, const uint8_t data[]) {
-    const auto size = width * height * channels;
-    flatbuffers::FlatBufferBuilder builder(size + 100);
-    auto imageData = builder.CreateVector(data, size);
-    auto image = msgs::CreateImage(builder, width, height, channels, imageData);
-    builder.Finish(image);
-    return std::make_shared<flatbuffers::DetachedBuffer>(builder.Release());
+    ImageBuffer imageBuffer(width, height, channels);
+    std::copy(data, data + imageBuffer.getSize(), imageBuffer.getData());
+    return imageBuffer.release();
 }
 
 Image Image::makeImage(const uint8_t buffer[]) {
@@ -30,4 +29,33 @@ Image Image::makeImage(const uint8_t buffer[]) {
     return image;
 }
 
+ImageView::ImageView(const uint8_t buffer[]) {
+    auto imageBuffer = msgs::GetImage(buffer);
+    this->width = imageBuffer->width();
+    this->height = imageBuffer->height();
+    this->channels = imageBuffer->channels();
+    this->stride = static_cast<size_t>(this->width) * this->channels;
+    this->data = imageBuffer->data()->data();
+}
+
+ImageView::ImageView(MsgPtr &&msg) : ImageView(msg.get()) {
+    this->msg = std::move(msg);
+}
+
+ImageBuffer::ImageBuffer(unsigned int width, unsigned int height, uint8_t channels) :
+    builder(static_cast<size_t>(width) * height * channels + 100, &BufferPool::get()), data(nullptr),
+    size(static_cast<size_t>(width) * height * channels) {
+    // Finish the msg around the uninitialized pixel data so the builder no longer moves it
+    uint8_t *imageData;
+    auto imageDataOffset = this->builder.CreateUninitializedVector(this->size, sizeof(uint8_t), &imageData);
+    auto image = msgs::CreateImage(this->builder, width, height, channels,
+                                   flatbuffers::Offset<flatbuffers::Vector<uint8_t>>(imageDataOffset));
+    this->builder.Finish(image);
+    this->data = const_cast<uint8_t *>(msgs::GetImage(this->builder.GetBufferPointer())->data()->data());
+}
+
+std::shared_ptr<flatbuffers::DetachedBuffer> ImageBuffer::release() {
+    return std::make_shared<flatbuffers::DetachedBuffer>(this->builder.Release());
+}
+
 } // namespace ntwk
@@ -6,12 +6,19 @@
 
 #include <network/msgs/Uint8Array_generated.h>
 
+#include "BufferPool.h"
+#include "TraceRecorder.h"
+
 namespace ntwk {
 namespace ImageJpeg {
 
 std::shared_ptr<flatbuffers::DetachedBuffer> compressImage(unsigned int width, unsigned int height,
                                                            uint8_t channels, const uint8_t data[],
                                                            int quality) {
+#ifdef NETWORK_TRACING
+    const trace::Scope traceScope(trace::Stage::ENCODE);
+#endif
+
     int format;
     switch (channels) {
     case 1:
@@ -42,7 +49,13 @@ std::shared_ptr<flatbuffers::DetachedBuffer> compressImage(unsigned int width, u
                                 "Failed to create compressor");
     }
 
-    auto jpeg = std::make_unique<uint8_t[]>(jpegSize);
+    // Compress into a buffer of the maximum jpeg size, which is given back with that size
+    auto &bufferPool = BufferPool::get();
+    const auto maxJpegSize = jpegSize;
+    auto releaseJpeg = [&bufferPool, maxJpegSize](uint8_t *jpeg) {
+        bufferPool.deallocate(jpeg, maxJpegSize);
+    };
+    std::unique_ptr<uint8_t, decltype(releaseJpeg)> jpeg(bufferPool.allocate(maxJpegSize), releaseJpeg);
     auto pJpeg = jpeg.get();
 
     auto result = tjCompress2(compressor.get(), data, width, 0, height, format,
@@ -55,7 +68,7 @@ std::shared_ptr<flatbuffers::DetachedBuffer> compressImage(unsigned int width, u
     }
 
     // Build message
-    flatbuffers::FlatBufferBuilder msgBuilder(jpegSize + 100);
+    flatbuffers::FlatBufferBuilder msgBuilder(jpegSize + 100, &bufferPool);
     auto jpegMsgData = msgBuilder.CreateVector(jpeg.get(), jpegSize);
     auto jpegMsg = msgs::CreateUint8Array(msgBuilder, jpegMsgData);
     msgBuilder.Finish(jpegMsg);
@@ -64,6 +77,10 @@ std::shared_ptr<flatbuffers::DetachedBuffer> compressImage(unsigned int width, u
 }
 
 Image decompressImage(const uint8_t jpegBuffer[]) {
+#ifdef NETWORK_TRACING
+    const trace::Scope traceScope(trace::Stage::DECODE);
+#endif
+
     std::shared_ptr<void> decompressor(tjInitDecompress(), tjDestroy);
 
     // Get jpeg image properties
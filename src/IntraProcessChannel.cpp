@@ -0,0 +1,149 @@
+#include "IntraProcessChannel.h"
+
+#include <unordered_map>
+
+#include <asio/post.hpp>
+
+namespace {
+
+// Msgs waiting for a subscriber's executor, enough for bursts of small msgs
+constexpr size_t MAX_QUEUED_MSGS = 1024;
+
+std::mutex registryMutex;
+std::unordered_map<std::string, std::weak_ptr<ntwk::IntraProcessChannel>> registry;
+
+} // namespace
+
+namespace ntwk {
+
+IntraProcessChannel::Subscriber::Subscriber(SubscriberId id, std::weak_ptr<asio::io_context> context,
+                                            asio::any_io_executor executor, MsgHandler msgHandler,
+                                            DropHandler dropHandler, CloseHandler closeHandler) :
+    id(id), context(std::move(context)), executor(std::move(executor)), msgHandler(std::move(msgHandler)),
+    dropHandler(std::move(dropHandler)), closeHandler(std::move(closeHandler)),
+    msgs(MAX_QUEUED_MSGS), msgHandlingScheduled(false) { }
+
+std::shared_ptr<IntraProcessChannel> IntraProcessChannel::advertise(const std::string &name) {
+    auto channel = std::make_shared<IntraProcessChannel>();
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry[name] = channel;
+    return channel;
+}
+
+std::shared_ptr<IntraProcessChannel> IntraProcessChannel::find(const std::string &name) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto channel = registry.find(name);
+    if (channel == registry.end()) {
+        return nullptr;
+    }
+
+    auto c = channel->second.lock();
+    if (!c) {
+        registry.erase(channel);
+    }
+    return c;
+}
+
+IntraProcessChannel::SubscriberId IntraProcessChannel::subscribe(std::weak_ptr<asio::io_context> subscriberContext,
+                                                                 asio::any_io_executor subscriberExecutor,
+                                                                 MsgHandler msgHandler, DropHandler dropHandler,
+                                                                 CloseHandler closeHandler) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->closed) {
+        return 0;
+    }
+
+    const auto id = this->nextSubscriberId++;
+    this->subscribers.push_back(std::make_shared<Subscriber>(id, std::move(subscriberContext),
+                                                             std::move(subscriberExecutor), std::move(msgHandler),
+                                                             std::move(dropHandler), std::move(closeHandler)));
+    this->subscriberCount.store(this->subscribers.size(), std::memory_order_release);
+    return id;
+}
+
+void IntraProcessChannel::subscribe(SubscriberId subscriberId, MsgTypeId msgTypeId) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto &s : this->subscribers) {
+        if (s->id == subscriberId) {
+            s->msgTypeIds.insert(msgTypeId);
+        }
+    }
+}
+
+void IntraProcessChannel::unsubscribe(SubscriberId subscriberId) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->subscribers.remove_if([subscriberId](const auto &s) { return s->id == subscriberId; });
+    this->subscriberCount.store(this->subscribers.size(), std::memory_order_release);
+}
+
+void IntraProcessChannel::publish(MsgTypeId msgTypeId,
+                                  const std::shared_ptr<flatbuffers::DetachedBuffer> &msg) {
+    if (this->subscriberCount.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto s = this->subscribers.begin(); s != this->subscribers.end();) {
+        if ((*s)->context.expired()) {
+            s = this->subscribers.erase(s);
+            this->subscriberCount.store(this->subscribers.size(), std::memory_order_release);
+            continue;
+        }
+
+        if (!(*s)->msgTypeIds.count(msgTypeId)) {
+            ++s;
+            continue;
+        }
+
+        if ((*s)->msgs.push(QueuedMsg{msgTypeId, msg})) {
+            scheduleMsgHandling(*s);
+        } else {
+            (*s)->dropHandler(msgTypeId);
+        }
+        ++s;
+    }
+}
+
+void IntraProcessChannel::close() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->closed = true;
+
+    for (auto &s : this->subscribers) {
+        auto context = s->context.lock();
+        if (context) {
+            asio::post(s->executor, std::move(s->closeHandler));
+        }
+    }
+    this->subscribers.clear();
+    this->subscriberCount.store(0, std::memory_order_release);
+}
+
+void IntraProcessChannel::scheduleMsgHandling(const std::shared_ptr<Subscriber> &subscriber) {
+    if (!subscriber->msgHandlingScheduled.exchange(true)) {
+        asio::post(subscriber->executor, bindHandlerMemory(subscriber->handlerMemory, [subscriber] {
+            handleMsgs(subscriber);
+        }));
+    }
+}
+
+void IntraProcessChannel::handleMsgs(const std::shared_ptr<Subscriber> &subscriber) {
+    // Msgs published from now on schedule another task
+    subscriber->msgHandlingScheduled.store(false);
+
+    // Handle at most a queue's worth of msgs so other tasks on the executor get their turn
+    QueuedMsg msg;
+    for (size_t i = 0; i < subscriber->msgs.capacity(); ++i) {
+        if (!subscriber->msgs.pop(msg)) {
+            return;
+        }
+
+        subscriber->msgHandler(msg.msgTypeId, std::move(msg.msg));
+    }
+
+    if (!subscriber->msgs.empty()) {
+        scheduleMsgHandling(subscriber);
+    }
+}
+
+} // namespace ntwk
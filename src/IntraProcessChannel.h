@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include <asio/any_io_executor.hpp>
+#include <asio/io_context.hpp>
+#include <flatbuffers/flatbuffers.h>
+
+#include <network/HandlerMemory.h>
+#include <network/MsgTypeId.h>
+
+#include "HandoffQueue.h"
+
+namespace ntwk {
+
+// Hands msgs from a publisher to subscribers in the same process without a socket.
+// Channels are registered process-wide by the name of the publisher's endpoint. Msgs are
+// handed to each subscriber through a bounded lock-free queue, which is drained by a single
+// task posted onto the subscriber's executor for each batch of msgs while its context is alive.
+// The context is only held weakly since it may be torn down at any time. Msgs that find the
+// queue of a subscriber full are dropped and passed to its drop handler instead. Like over
+// sockets, subscribers only get msgs of the msg types they subscribed to.
+class IntraProcessChannel {
+public:
+    using MsgHandler = std::function<void(MsgTypeId, std::shared_ptr<flatbuffers::DetachedBuffer>)>;
+    using DropHandler = std::function<void(MsgTypeId)>;
+    using CloseHandler = std::function<void()>;
+    using SubscriberId = uint64_t;
+
+    static std::shared_ptr<IntraProcessChannel> advertise(const std::string &name);
+    static std::shared_ptr<IntraProcessChannel> find(const std::string &name);
+
+    // Returns 0 once the channel is closed
+    SubscriberId subscribe(std::weak_ptr<asio::io_context> subscriberContext,
+                           asio::any_io_executor subscriberExecutor,
+                           MsgHandler msgHandler, DropHandler dropHandler, CloseHandler closeHandler);
+    void subscribe(SubscriberId subscriberId, MsgTypeId msgTypeId);
+    void unsubscribe(SubscriberId subscriberId);
+
+    void publish(MsgTypeId msgTypeId, const std::shared_ptr<flatbuffers::DetachedBuffer> &msg);
+    void close();
+
+private:
+    struct QueuedMsg {
+        MsgTypeId msgTypeId{};
+        std::shared_ptr<flatbuffers::DetachedBuffer> msg;
+    };
+
+    struct Subscriber {
+        SubscriberId id;
+        std::weak_ptr<asio::io_context> context;
+        asio::any_io_executor executor;
+        MsgHandler msgHandler;
+        DropHandler dropHandler;
+        CloseHandler closeHandler;
+
+        HandoffQueue<QueuedMsg> msgs;
+        std::atomic<bool> msgHandlingScheduled;
+
+        // Tasks posted to the executor
+        HandlerMemory handlerMemory;
+
+        // Guarded by the mutex of the channel
+        std::unordered_set<MsgTypeId> msgTypeIds;
+
+        Subscriber(SubscriberId id, std::weak_ptr<asio::io_context> context, asio::any_io_executor executor,
+                   MsgHandler msgHandler, DropHandler dropHandler, CloseHandler closeHandler);
+    };
+
+    static void scheduleMsgHandling(const std::shared_ptr<Subscriber> &subscriber);
+    static void handleMsgs(const std::shared_ptr<Subscriber> &subscriber);
+
+    std::mutex mutex;
+    std::list<std::shared_ptr<Subscriber>> subscribers;
+    SubscriberId nextSubscriberId = 1;
+    bool closed = false;
+
+    // Size of the subscriber list, so that publishing without subscribers skips the lock
+    std::atomic<size_t> subscriberCount{0};
+};
+
+} // namespace ntwk
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <network/Metrics.h>
+#include <network/MsgTypeId.h>
+
+namespace ntwk {
+
+// Counters behind TopicMetrics and ConnectionMetrics. They are updated on the strands of the
+// connections and read by snapshots on any thread, so they are relaxed atomics and snapshots
+// may be slightly out of date with each other. Queued msgs are counted up and down by
+// different threads, so they are signed.
+struct TopicCounters {
+    std::atomic<uint64_t> msgs{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> overwrittenMsgs{0};
+    std::atomic<uint64_t> droppedMsgs{0};
+    std::atomic<int64_t> queuedMsgs{0};
+
+    TopicMetrics getMetrics(MsgTypeId msgTypeId) const {
+        TopicMetrics metrics;
+        metrics.msgTypeId = msgTypeId;
+        metrics.msgs = this->msgs.load(std::memory_order_relaxed);
+        metrics.bytes = this->bytes.load(std::memory_order_relaxed);
+        metrics.overwrittenMsgs = this->overwrittenMsgs.load(std::memory_order_relaxed);
+        metrics.droppedMsgs = this->droppedMsgs.load(std::memory_order_relaxed);
+        metrics.queuedMsgs = static_cast<uint64_t>(std::max<int64_t>(this->queuedMsgs.load(std::memory_order_relaxed), 0));
+        return metrics;
+    }
+};
+
+struct ConnectionCounters {
+    const std::string endpoint;
+    std::atomic<uint64_t> msgs{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> queuedMsgs{0};
+    std::atomic<uint64_t> sendTime{0};
+    std::atomic<uint64_t> ackRoundTripTime{0};
+    std::atomic<uint64_t> reconnects{0};
+
+    explicit ConnectionCounters(std::string endpoint) : endpoint(std::move(endpoint)) { }
+
+    // Smoothed like the round trip time of TCP, by 1/8 of each sample
+    void addAckRoundTripTime(uint64_t roundTripTime) {
+        const auto smoothed = this->ackRoundTripTime.load(std::memory_order_relaxed);
+        this->ackRoundTripTime.store(smoothed ? smoothed - smoothed / 8 + roundTripTime / 8 : roundTripTime,
+                                     std::memory_order_relaxed);
+    }
+
+    ConnectionMetrics getMetrics() const {
+        ConnectionMetrics metrics;
+        metrics.endpoint = this->endpoint;
+        metrics.msgs = this->msgs.load(std::memory_order_relaxed);
+        metrics.bytes = this->bytes.load(std::memory_order_relaxed);
+        metrics.queuedMsgs = this->queuedMsgs.load(std::memory_order_relaxed);
+        metrics.sendTime = this->sendTime.load(std::memory_order_relaxed);
+        metrics.ackRoundTripTime = this->ackRoundTripTime.load(std::memory_order_relaxed);
+        metrics.reconnects = this->reconnects.load(std::memory_order_relaxed);
+        return metrics;
+    }
+};
+
+} // namespace ntwk
@@ -0,0 +1,51 @@
+#include <network/MsgStats.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ntwk {
+
+constexpr unsigned int LatencyHistogram::SUB_BUCKET_BITS;
+constexpr unsigned int LatencyHistogram::MAX_LATENCY_BITS;
+constexpr size_t LatencyHistogram::BUCKET_COUNT;
+
+size_t LatencyHistogram::getBucket(uint64_t latency) {
+    latency = std::min(latency, (uint64_t(1) << MAX_LATENCY_BITS) - 1);
+    if (latency < (uint64_t(1) << SUB_BUCKET_BITS)) {
+        return static_cast<size_t>(latency);
+    }
+
+    // Keep the SUB_BUCKET_BITS bits below the highest bit set
+    const unsigned int highestBit = 63 - __builtin_clzll(latency);
+    const auto shift = highestBit - SUB_BUCKET_BITS;
+    return (size_t(shift) << SUB_BUCKET_BITS) + static_cast<size_t>(latency >> shift);
+}
+
+uint64_t LatencyHistogram::getBucketLatency(size_t bucket) {
+    const auto group = bucket >> SUB_BUCKET_BITS;
+    if (group == 0) {
+        return bucket;
+    }
+
+    const auto subBucket = (bucket & ((size_t(1) << SUB_BUCKET_BITS) - 1)) | (size_t(1) << SUB_BUCKET_BITS);
+    return uint64_t(subBucket) << (group - 1);
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const {
+    if (this->count == 0) {
+        return 0;
+    }
+
+    const auto rank = std::max<uint64_t>(static_cast<uint64_t>(
+        std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100 * this->count)), 1);
+    uint64_t counted = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        counted += this->counts[bucket];
+        if (counted >= rank) {
+            return getBucketLatency(bucket + 1) - 1;
+        }
+    }
+    return getBucketLatency(BUCKET_COUNT) - 1;
+}
+
+} // namespace ntwk
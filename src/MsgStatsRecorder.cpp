@@ -0,0 +1,44 @@
+#include "MsgStatsRecorder.h"
+
+#include "Protocol.h"
+
+namespace ntwk {
+
+MsgStatsRecorder::MsgStatsRecorder() :
+    receivedMsgs(0), missedMsgs(0), gaps(0), connection(0), nextSequence(0) {
+    for (auto &count : this->latencyCounts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void MsgStatsRecorder::recordSequence(uint64_t connection, uint64_t sequence) {
+    if (connection == this->connection && sequence > this->nextSequence) {
+        this->missedMsgs.fetch_add(sequence - this->nextSequence, std::memory_order_relaxed);
+        this->gaps.fetch_add(1, std::memory_order_relaxed);
+    }
+    this->connection = connection;
+    this->nextSequence = sequence + 1;
+    this->receivedMsgs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MsgStatsRecorder::recordLatency(uint64_t publishTime) {
+    const auto now = protocol::getPublishTime();
+    const auto bucket = LatencyHistogram::getBucket(now > publishTime ? now - publishTime : 0);
+    this->latencyCounts[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+MsgStats MsgStatsRecorder::getStats() const {
+    MsgStats stats;
+    stats.receivedMsgs = this->receivedMsgs.load(std::memory_order_relaxed);
+    stats.missedMsgs = this->missedMsgs.load(std::memory_order_relaxed);
+    stats.gaps = this->gaps.load(std::memory_order_relaxed);
+    for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+        const auto count = this->latencyCounts[bucket].load(std::memory_order_relaxed);
+        if (count) {
+            stats.latency.add(bucket, count);
+        }
+    }
+    return stats;
+}
+
+} // namespace ntwk
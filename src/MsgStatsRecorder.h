@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <network/MsgStats.h>
+
+namespace ntwk {
+
+// Records the MsgStats of a msg type received by a subscriber. Sequence numbers are recorded
+// on the subscriber's strand and latencies wherever msgs are handled, while stats are read
+// from any thread, so the counts are relaxed atomics.
+class MsgStatsRecorder {
+public:
+    MsgStatsRecorder();
+
+    MsgStatsRecorder(const MsgStatsRecorder &other) = delete;
+    MsgStatsRecorder &operator=(const MsgStatsRecorder &other) = delete;
+
+    // Sequence numbers are only compared within a connection, as publishers count from 0 again
+    // when restarted and msgs published while disconnected were never meant to be received
+    void recordSequence(uint64_t connection, uint64_t sequence);
+    void recordLatency(uint64_t publishTime);
+
+    MsgStats getStats() const;
+
+private:
+    std::atomic<uint64_t> receivedMsgs;
+    std::atomic<uint64_t> missedMsgs;
+    std::atomic<uint64_t> gaps;
+    std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT> latencyCounts;
+
+    // Subscriber's strand
+    uint64_t connection;
+    uint64_t nextSequence;
+};
+
+} // namespace ntwk
@@ -0,0 +1,25 @@
+#include <network/NetworkRuntime.h>
+
+#include <algorithm>
+
+namespace ntwk {
+
+NetworkRuntime::NetworkRuntime(unsigned int threadCount, const std::vector<unsigned int> &cpus) :
+    context(std::make_shared<asio::io_context>(std::max(threadCount, 1u))) {
+    for (unsigned int i = 0; i < std::max(threadCount, 1u); ++i) {
+        this->threads.emplace_back(std::make_unique<Thread>(this->context));
+        if (!cpus.empty()) {
+            this->threads.back()->setCpuAffinity(cpus[i % cpus.size()]);
+        }
+    }
+}
+
+const NetworkRuntime::ContextPtr &NetworkRuntime::getContext() const {
+    return this->context;
+}
+
+unsigned int NetworkRuntime::getThreadCount() const {
+    return static_cast<unsigned int>(this->threads.size());
+}
+
+} // namespace ntwk
@@ -1,34 +1,193 @@
 #include <network/Node.h>
 
+#include <future>
+#include <vector>
+
 #include <network/TcpPublisher.h>
 #include <network/TcpSubscriber.h>
+#include <network/Transport.h>
+#include <network/UdpPublisher.h>
+#include <network/UdpSubscriber.h>
+
+namespace {
+
+// Subscribers are kept by the uri of their endpoint, so differently spelled uris of the same
+// endpoint share a subscriber
+std::string getSubscriberUri(const std::string &endpoint) {
+    return ntwk::transport::getUri(ntwk::transport::makeEndpoint(endpoint));
+}
+
+} // namespace
 
 namespace ntwk {
 
-Node::Node(ContextPtr context) :
-    mainContext(std::move(context)),
-    ntwkContext(std::make_shared<asio::io_context>()),
-    ntwkThread(ntwkContext) { }
+Node::Node(ContextPtr context, unsigned int ntwkThreadCount) :
+    Node(std::move(context), std::make_shared<NetworkRuntime>(ntwkThreadCount)) { }
+
+Node::Node(ContextPtr context, RuntimePtr ntwkRuntime) :
+    mainContext(std::move(context)), ntwkRuntime(std::move(ntwkRuntime)),
+    ntwkContext(this->ntwkRuntime->getContext()), metricsPeriod(0), metricsGeneration(0) { }
 
 Node::~Node() {
+    // A shared runtime keeps running, so stop the connections instead of the threads. They
+    // are closed on their strands, which may still be handing msgs to the main context.
+    std::vector<std::future<void>> closed;
+    for (auto &s : this->subscribers) {
+        closed.push_back(s.second->close());
+    }
+    for (auto &s : this->multicastSubscribers) {
+        closed.push_back(s.second->close());
+    }
+    if (this->publisher) {
+        closed.push_back(this->publisher->close());
+    }
+    if (this->multicastPublisher) {
+        closed.push_back(this->multicastPublisher->close());
+    }
+    for (auto &c : closed) {
+        c.wait();
+    }
+
     this->mainContext->stop();
 }
 
-void Node::advertise(unsigned short port) {
-    this->publisher = TcpPublisher::create(*this->ntwkContext, port);
+void Node::advertise(unsigned short port, unsigned int windowSize) {
+    this->advertise(transport::makeUri("0.0.0.0", port), windowSize);
 }
 
-void Node::subscribe(const Endpoint &endpoint, MsgTypeId msgType, MsgHandler msgHandler) {
-    auto &s = this->subscribers[endpoint];
+void Node::advertise(const std::string &endpoint, unsigned int windowSize) {
+    if (transport::isMulticast(endpoint)) {
+        this->multicastPublisher = UdpPublisher::create(*this->ntwkContext, endpoint);
+        return;
+    }
+    this->publisher = TcpPublisher::create(*this->ntwkContext, endpoint, windowSize);
+}
+
+void Node::subscribe(const Endpoint &endpoint, MsgTypeId msgType, MsgHandler msgHandler,
+                     const QoS &qos, const Dispatch &dispatch) {
+    this->subscribeUri(transport::makeUri(endpoint.first, endpoint.second), msgType,
+                       withoutSize(std::move(msgHandler)), qos, dispatch);
+}
+
+void Node::subscribe(const Endpoint &endpoint, const Topic &topic, MsgHandler msgHandler,
+                     const QoS &qos, const Dispatch &dispatch) {
+    registerTopic(topic);
+    this->subscribe(endpoint, topic.getId(), std::move(msgHandler), qos, dispatch);
+}
+
+Node::SizedMsgHandler Node::withoutSize(MsgHandler msgHandler) {
+    return [msgHandler=std::move(msgHandler)](MsgPtr &&msg, size_t) {
+        msgHandler(std::move(msg));
+    };
+}
+
+void Node::subscribeUri(const std::string &endpoint, MsgTypeId msgType, SizedMsgHandler msgHandler,
+                        const QoS &qos, const Dispatch &dispatch) {
+    if (transport::isMulticast(endpoint)) {
+        auto &s = this->multicastSubscribers[endpoint];
+        if (!s) {
+            s = UdpSubscriber::create(this->mainContext, this->ntwkContext, endpoint);
+        }
+        s->subscribe(msgType, std::move(msgHandler), qos, dispatch);
+        return;
+    }
+
+    auto &s = this->subscribers[getSubscriberUri(endpoint)];
     if (!s) {
-        s = TcpSubscriber::create(*this->mainContext, *this->ntwkContext,
-                                  endpoint.first, endpoint.second);
+        s = TcpSubscriber::create(this->mainContext, this->ntwkContext, endpoint);
     }
-    s->subscribe(msgType, std::move(msgHandler));
+    s->subscribe(msgType, std::move(msgHandler), qos, dispatch);
 }
 
 void Node::publish(MsgTypeId msgTypeId, std::shared_ptr<flatbuffers::DetachedBuffer> msg) {
-    this->publisher->publish(msgTypeId, std::move(msg));
+    if (this->multicastPublisher) {
+        this->multicastPublisher->publish(msgTypeId, msg);
+    }
+    if (this->publisher) {
+        this->publisher->publish(msgTypeId, std::move(msg));
+    }
+}
+
+void Node::publish(const Topic &topic, std::shared_ptr<flatbuffers::DetachedBuffer> msg) {
+    registerTopic(topic);
+    this->publish(topic.getId(), std::move(msg));
+}
+
+void Node::setQoS(MsgTypeId msgTypeId, const QoS &qos) {
+    if (this->multicastPublisher) {
+        this->multicastPublisher->setQoS(msgTypeId, qos);
+    }
+    if (this->publisher) {
+        this->publisher->setQoS(msgTypeId, qos);
+    }
+}
+
+QueueStats Node::getQueueStats(MsgTypeId msgTypeId) const {
+    QueueStats stats;
+    if (this->multicastPublisher) {
+        stats = this->multicastPublisher->getQueueStats(msgTypeId);
+    }
+    if (this->publisher) {
+        const auto publisherStats = this->publisher->getQueueStats(msgTypeId);
+        stats.overwrittenMsgs += publisherStats.overwrittenMsgs;
+        stats.droppedMsgs += publisherStats.droppedMsgs;
+    }
+    return stats;
+}
+
+QueueStats Node::getQueueStats(const std::string &endpoint, MsgTypeId msgTypeId) const {
+    if (transport::isMulticast(endpoint)) {
+        auto s = this->multicastSubscribers.find(endpoint);
+        return s != this->multicastSubscribers.cend() ? s->second->getQueueStats(msgTypeId) : QueueStats();
+    }
+
+    auto s = this->subscribers.find(getSubscriberUri(endpoint));
+    return s != this->subscribers.cend() ? s->second->getQueueStats(msgTypeId) : QueueStats();
+}
+
+MsgStats Node::getMsgStats(const std::string &endpoint, MsgTypeId msgTypeId) const {
+    auto s = this->subscribers.find(getSubscriberUri(endpoint));
+    return s != this->subscribers.cend() ? s->second->getMsgStats(msgTypeId) : MsgStats();
+}
+
+Metrics Node::getMetrics() const {
+    Metrics metrics;
+    if (this->publisher) {
+        metrics.publisher = this->publisher->getMetrics();
+    }
+    for (const auto &s : this->subscribers) {
+        metrics.subscribers[s.first] = s.second->getMetrics();
+    }
+    return metrics;
+}
+
+void Node::setMetricsHandler(std::chrono::milliseconds period, MetricsHandler metricsHandler) {
+    this->metricsPeriod = period;
+    this->metricsHandler = std::move(metricsHandler);
+    ++this->metricsGeneration;
+    if (this->metricsTimer) {
+        this->metricsTimer->cancel();
+    }
+
+    if (this->metricsHandler) {
+        if (!this->metricsTimer) {
+            this->metricsTimer = std::make_unique<asio::steady_timer>(*this->mainContext);
+        }
+        this->scheduleMetricsHandler();
+    }
+}
+
+void Node::scheduleMetricsHandler() {
+    // The timer is cancelled with the Node
+    this->metricsTimer->expires_after(this->metricsPeriod);
+    this->metricsTimer->async_wait([this, generation=this->metricsGeneration](const auto &error) {
+        if (error || generation != this->metricsGeneration) {
+            return;
+        }
+
+        this->metricsHandler(this->getMetrics());
+        this->scheduleMetricsHandler();
+    });
 }
 
 void Node::run() {
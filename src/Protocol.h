@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ntwk {
+namespace protocol {
+
+// Version 0 is the original stop-and-wait protocol where every msg is acknowledged
+// with a single msgs::MsgCtrl::ACK byte. Newer versions are negotiated with a
+// msgs::Handshake that the publisher sends as the first msg of a connection.
+constexpr uint32_t LEGACY_VERSION = 0;
+constexpr uint32_t WINDOWED_ACK_VERSION = 1;
+constexpr uint32_t SHARED_MEMORY_VERSION = 2;
+constexpr uint32_t SUBSCRIPTION_VERSION = 3;
+constexpr uint32_t MSG_STAMP_VERSION = 4;
+constexpr uint32_t VERSION = MSG_STAMP_VERSION;
+
+// Msgs whose data lives in a shared memory slot are announced with this bit set in the
+// msg type id of the header, followed by a msgs::SharedMemorySlot instead of the data
+constexpr uint32_t SHARED_MEMORY_MSG_FLAG = 0x80000000;
+
+// Subscribers send the msg type ids they handle as a msgs::MsgCtrl::SUBSCRIBE ctrl msg
+// followed by that many uint32 msg type ids. Only those msg types are published to them.
+constexpr uint32_t MAX_SUBSCRIBED_MSG_TYPES = 1024;
+
+// From MSG_STAMP_VERSION on, the header of every msg but ctrl msgs is followed by a
+// msgs::MsgStamp, which is not counted in the msg size of the header. It carries the time
+// the msg was published and its sequence number among the msgs of its msg type.
+inline uint64_t getPublishTime() {
+    // Monotonic, so latencies are only measured between processes on the same host
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+constexpr unsigned int SHARED_MEMORY_SLOT_COUNT = 8;
+constexpr size_t SHARED_MEMORY_SLOT_SIZE = 8 * 1024 * 1024;
+
+// Multicast msgs are sent as datagrams of a msgs::MulticastFragment followed by up to
+// MULTICAST_FRAGMENT_SIZE bytes of the msg, small enough to avoid IP fragmentation on Ethernet
+constexpr size_t MULTICAST_FRAGMENT_SIZE = 1400;
+constexpr size_t MULTICAST_MAX_DATAGRAM_SIZE = 65507;
+
+// Larger multicast msgs are dropped by publishers and ignored by subscribers, which would
+// otherwise allocate whatever size a datagram claims
+constexpr size_t MULTICAST_MAX_MSG_SIZE = 64 * 1024 * 1024;
+
+} // namespace protocol
+} // namespace ntwk
@@ -0,0 +1,42 @@
+#include "ReceiveBufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+constexpr size_t MIN_BUFFER_SIZE = 256;
+constexpr size_t MAX_BUFFERS_PER_SIZE_CLASS = 4;
+
+} // namespace
+
+namespace ntwk {
+
+MutableMsgPtr ReceiveBufferPool::acquire(size_t msgSize) {
+    size_t sizeClass = 0;
+    while ((MIN_BUFFER_SIZE << sizeClass) < msgSize) {
+        ++sizeClass;
+    }
+    if (sizeClass >= this->sizeClasses.size()) {
+        this->sizeClasses.resize(sizeClass + 1);
+    }
+
+    auto &buffers = this->sizeClasses[sizeClass];
+    auto buffer = std::find_if(buffers.cbegin(), buffers.cend(), [](const auto &buffer) {
+        return buffer.use_count() == 1;
+    });
+    if (buffer != buffers.cend()) {
+        // The pool holds the only reference once the msg is released, which must happen
+        // before the buffer is written to again
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } else if (buffers.size() < MAX_BUFFERS_PER_SIZE_CLASS) {
+        buffer = buffers.insert(buffers.cend(), std::make_shared<Buffer>(MIN_BUFFER_SIZE << sizeClass));
+    } else {
+        return MutableMsgPtr(new uint8_t[msgSize]);
+    }
+
+    auto pMsg = (*buffer)->data.get();
+    return MutableMsgPtr(pMsg, MsgDeleter(std::shared_ptr<const void>(*buffer, pMsg)));
+}
+
+} // namespace ntwk
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <network/MsgPtr.h>
+
+namespace ntwk {
+
+// Buffers msgs are received into, reused once the msg received into them is released. Buffers
+// are grouped into power of two size classes, so a steady stream of msgs of similar size
+// neither allocates nor faults in fresh pages. Only a few buffers of each size class are kept,
+// further msgs received while all of them are held get a buffer of their own.
+//
+// Buffers are taken on the subscriber's strand, while msgs may be released on any thread.
+class ReceiveBufferPool {
+public:
+    ReceiveBufferPool() = default;
+
+    ReceiveBufferPool(const ReceiveBufferPool &other) = delete;
+    ReceiveBufferPool &operator=(const ReceiveBufferPool &other) = delete;
+
+    // Returns a msg of at least msgSize bytes
+    MutableMsgPtr acquire(size_t msgSize);
+
+private:
+    struct Buffer {
+        explicit Buffer(size_t size) : data(new uint8_t[size]) { }
+
+        std::unique_ptr<uint8_t[]> data;
+    };
+
+    std::vector<std::vector<std::shared_ptr<Buffer>>> sizeClasses;
+};
+
+} // namespace ntwk
@@ -0,0 +1,241 @@
+#include "SharedMemorySegment.h"
+
+#include <atomic>
+#include <cerrno>
+#include <new>
+#include <system_error>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Changed along with the layout of the segment
+constexpr uint32_t MAGIC = 0x6e74776c;
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr size_t PAGE_SIZE = 4096;
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t slotCount;
+    uint64_t slotSize;
+};
+
+struct HolderHeader {
+    std::atomic<uint32_t> mappings;
+    std::atomic<int32_t> pid;
+};
+
+struct alignas(CACHE_LINE_SIZE) SlotHeader {
+    std::atomic<uint64_t> holders;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory slots require lock free atomics");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Shared memory holders require lock free atomics");
+
+std::atomic<unsigned int> segmentCount{0};
+
+constexpr size_t roundUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// The segment header is followed by the holder headers, the slot headers and the slots
+constexpr size_t SLOT_HEADERS_OFFSET = CACHE_LINE_SIZE +
+        roundUp(ntwk::SharedMemorySegment::MAX_SUBSCRIBER_HOLDERS * sizeof(HolderHeader), CACHE_LINE_SIZE);
+
+size_t getSlotsOffset(unsigned int slotCount) {
+    return roundUp(SLOT_HEADERS_OFFSET + size_t(slotCount) * sizeof(SlotHeader), PAGE_SIZE);
+}
+
+SegmentHeader *getHeader(void *address) {
+    return static_cast<SegmentHeader *>(address);
+}
+
+HolderHeader *getHolderHeaders(void *address) {
+    return reinterpret_cast<HolderHeader *>(static_cast<uint8_t *>(address) + CACHE_LINE_SIZE);
+}
+
+SlotHeader *getSlotHeaders(void *address) {
+    return reinterpret_cast<SlotHeader *>(static_cast<uint8_t *>(address) + SLOT_HEADERS_OFFSET);
+}
+
+void *map(int fd, size_t size) {
+    auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(), "Failed to map shared memory");
+    }
+    return address;
+}
+
+} // namespace
+
+namespace ntwk {
+
+std::shared_ptr<SharedMemorySegment> SharedMemorySegment::create(unsigned int slotCount, size_t slotSize) {
+    const auto name = "/ntwk-" + std::to_string(getpid()) + "-" + std::to_string(segmentCount++);
+    slotSize = roundUp(slotSize, PAGE_SIZE);
+    const auto size = getSlotsOffset(slotCount) + slotCount * slotSize;
+
+    auto fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        throw std::system_error(errno, std::system_category(), "Failed to create shared memory");
+    }
+
+    void *address = nullptr;
+    try {
+        if (ftruncate(fd, size) != 0) {
+            throw std::system_error(errno, std::system_category(), "Failed to size shared memory");
+        }
+        address = map(fd, size);
+    } catch (...) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw;
+    }
+    close(fd);
+
+    auto header = getHeader(address);
+    header->magic = MAGIC;
+    header->slotCount = slotCount;
+    header->slotSize = slotSize;
+
+    auto holderHeaders = getHolderHeaders(address);
+    for (unsigned int i = 0; i < MAX_SUBSCRIBER_HOLDERS; ++i) {
+        new (&holderHeaders[i]) HolderHeader{{0}, {0}};
+    }
+
+    auto slotHeaders = getSlotHeaders(address);
+    for (unsigned int i = 0; i < slotCount; ++i) {
+        new (&slotHeaders[i]) SlotHeader{{0}};
+    }
+
+    return std::shared_ptr<SharedMemorySegment>(new SharedMemorySegment(name, true, address, size));
+}
+
+std::shared_ptr<SharedMemorySegment> SharedMemorySegment::open(const std::string &name,
+                                                               unsigned int holder) {
+    if (holder >= MAX_SUBSCRIBER_HOLDERS) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                "Invalid shared memory holder");
+    }
+
+    auto fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::system_category(), "Failed to open shared memory");
+    }
+
+    struct stat status;
+    void *address = nullptr;
+    try {
+        if (fstat(fd, &status) != 0) {
+            throw std::system_error(errno, std::system_category(), "Failed to query shared memory");
+        }
+        if (static_cast<size_t>(status.st_size) < getSlotsOffset(0)) {
+            throw std::system_error(std::make_error_code(std::errc::protocol_error),
+                                    "Invalid shared memory size");
+        }
+        address = map(fd, status.st_size);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    std::shared_ptr<SharedMemorySegment> segment(new SharedMemorySegment(name, false, address,
+                                                                         status.st_size));
+    // The slots must fit the segment without the size of the slots overflowing
+    auto header = getHeader(address);
+    const auto slotsOffset = getSlotsOffset(header->slotCount);
+    if (header->magic != MAGIC || slotsOffset > segment->size ||
+            (header->slotSize && header->slotCount > (segment->size - slotsOffset) / header->slotSize)) {
+        throw std::system_error(std::make_error_code(std::errc::protocol_error),
+                                "Invalid shared memory layout");
+    }
+
+    auto &holderHeader = getHolderHeaders(address)[holder];
+    holderHeader.mappings.fetch_add(1, std::memory_order_acq_rel);
+    holderHeader.pid.store(getpid(), std::memory_order_release);
+    segment->holder = holder;
+    return segment;
+}
+
+SharedMemorySegment::SharedMemorySegment(std::string name, bool unlinkOnDestruction,
+                                         void *address, size_t size) :
+    name(std::move(name)), unlinkOnDestruction(unlinkOnDestruction),
+    address(address), size(size) { }
+
+SharedMemorySegment::~SharedMemorySegment() {
+    // The holder's slots are no longer released through this mapping
+    if (this->holder >= 0) {
+        getHolderHeaders(this->address)[this->holder].mappings.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    munmap(this->address, this->size);
+    if (this->unlinkOnDestruction) {
+        shm_unlink(this->name.c_str());
+    }
+}
+
+const std::string &SharedMemorySegment::getName() const {
+    return this->name;
+}
+
+unsigned int SharedMemorySegment::getSlotCount() const {
+    return getHeader(this->address)->slotCount;
+}
+
+size_t SharedMemorySegment::getSlotSize() const {
+    return getHeader(this->address)->slotSize;
+}
+
+uint8_t *SharedMemorySegment::getSlotData(unsigned int slot) {
+    return static_cast<uint8_t *>(this->address) + getSlotsOffset(this->getSlotCount()) +
+            slot * this->getSlotSize();
+}
+
+int SharedMemorySegment::acquireSlot() {
+    // Round robin so recently released slots are reused last
+    const auto slotCount = this->getSlotCount();
+    auto slotHeaders = getSlotHeaders(this->address);
+    for (unsigned int i = 0; i < slotCount; ++i) {
+        const auto slot = (this->nextSlot + i) % slotCount;
+        uint64_t holders = 0;
+        if (slotHeaders[slot].holders.compare_exchange_strong(holders, 1ull << PUBLISHER_HOLDER,
+                                                              std::memory_order_acquire)) {
+            this->nextSlot = (slot + 1) % slotCount;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+void SharedMemorySegment::hold(unsigned int slot, unsigned int holder) {
+    getSlotHeaders(this->address)[slot].holders.fetch_or(1ull << holder, std::memory_order_release);
+}
+
+void SharedMemorySegment::release(unsigned int slot, unsigned int holder) {
+    getSlotHeaders(this->address)[slot].holders.fetch_and(~(1ull << holder),
+                                                          std::memory_order_release);
+}
+
+void SharedMemorySegment::releaseAll(unsigned int holder) {
+    const auto slotCount = this->getSlotCount();
+    for (unsigned int i = 0; i < slotCount; ++i) {
+        this->release(i, holder);
+    }
+}
+
+bool SharedMemorySegment::isMapped(unsigned int holder) const {
+    const auto &holderHeader = getHolderHeaders(this->address)[holder];
+    if (holderHeader.mappings.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    // Subscribers that exited without unmapping the segment leave their mappings behind
+    const auto pid = holderHeader.pid.load(std::memory_order_acquire);
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+} // namespace ntwk
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ntwk {
+
+// Fixed number of equally sized msg slots in POSIX shared memory, created by a publisher
+// and mapped by subscribers on the same host. Each slot keeps a bitmask of its holders
+// so the slots held by a disconnected subscriber can be reclaimed. Subscribers map the
+// segment as one of the holders, and the segment counts the mappings of each holder so
+// that a holder is not handed to another subscriber while msgs of its previous subscriber
+// may still release their slots.
+class SharedMemorySegment {
+public:
+    // The publisher holds a slot while it is being filled and still queued for sending
+    static constexpr unsigned int PUBLISHER_HOLDER = 63;
+    static constexpr unsigned int MAX_SUBSCRIBER_HOLDERS = PUBLISHER_HOLDER;
+
+    static std::shared_ptr<SharedMemorySegment> create(unsigned int slotCount, size_t slotSize);
+    static std::shared_ptr<SharedMemorySegment> open(const std::string &name, unsigned int holder);
+    ~SharedMemorySegment();
+
+    SharedMemorySegment(const SharedMemorySegment &other) = delete;
+    SharedMemorySegment &operator=(const SharedMemorySegment &other) = delete;
+
+    const std::string &getName() const;
+    unsigned int getSlotCount() const;
+    size_t getSlotSize() const;
+    uint8_t *getSlotData(unsigned int slot);
+
+    // Returns a free slot held by the publisher or -1 if all slots are in use
+    int acquireSlot();
+    void hold(unsigned int slot, unsigned int holder);
+    void release(unsigned int slot, unsigned int holder);
+    void releaseAll(unsigned int holder);
+
+    // Whether a process that is still running maps the segment as the holder
+    bool isMapped(unsigned int holder) const;
+
+private:
+    SharedMemorySegment(std::string name, bool unlinkOnDestruction, void *address, size_t size);
+
+    std::string name;
+    bool unlinkOnDestruction;
+    void *address;
+    size_t size;
+    int holder = -1;
+    unsigned int nextSlot = 0;
+};
+
+} // namespace ntwk
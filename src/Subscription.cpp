@@ -0,0 +1,136 @@
+#include "Subscription.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <asio/post.hpp>
+
+#include "MetricsCounters.h"
+#include "MsgStatsRecorder.h"
+#include "TraceRecorder.h"
+
+namespace {
+
+// KEEP_ALL subscriptions are bounded by bytes, the number of msgs only needs to cover bursts
+// of small msgs
+constexpr size_t KEEP_ALL_MAX_MSGS = 1024;
+
+} // namespace
+
+namespace ntwk {
+
+Subscription::Subscription(MsgTypeId msgTypeId, std::weak_ptr<asio::io_context> mainContext,
+                           MsgHandler msgHandler, const QoS &qos, const Dispatch &dispatch,
+                           std::shared_ptr<MsgStatsRecorder> stats, std::shared_ptr<TopicCounters> counters) :
+    msgTypeId(msgTypeId), mainContext(std::move(mainContext)), msgHandler(std::move(msgHandler)), qos(qos),
+    dispatch(dispatch), stats(std::move(stats)), counters(std::move(counters)),
+    msgs(dispatch.target != Dispatch::Target::MAIN_CONTEXT ? 1 :
+         qos.history == QoS::History::KEEP_ALL ? KEEP_ALL_MAX_MSGS : std::max<size_t>(qos.depth, 1)),
+    queuedBytes(0), msgHandlingScheduled(false) { }
+
+Subscription::Result Subscription::push(MsgPtr &&msg, size_t msgSize, const msgs::MsgStamp *msgStamp,
+                                        uint16_t connectionPort) {
+    QueuedMsg queuedMsg{std::move(msg), msgSize, msgStamp ? msgStamp->publish_time() : 0};
+#ifdef NETWORK_TRACING
+    queuedMsg.sequence = msgStamp ? msgStamp->sequence() : trace::NO_SEQUENCE;
+    queuedMsg.queuedTime = trace::now();
+    queuedMsg.connectionPort = connectionPort;
+#else
+    static_cast<void>(connectionPort);
+#endif
+    if (this->dispatch.target == Dispatch::Target::NETWORK_THREAD) {
+        this->handleMsg(std::move(queuedMsg));
+        return Result::QUEUED;
+    }
+
+    if (this->dispatch.target == Dispatch::Target::EXECUTOR) {
+        this->countQueuedMsgs(1);
+        asio::post(this->dispatch.executor, bindHandlerMemory(this->handlerMemory,
+                   [subscription=this->shared_from_this(), msg=std::move(queuedMsg)]() mutable {
+            subscription->countQueuedMsgs(-1);
+            subscription->handleMsg(std::move(msg));
+        }));
+        return Result::QUEUED;
+    }
+
+    // Account for the msg first as it may be handled as soon as it is pushed
+    auto result = Result::QUEUED;
+    this->countQueuedMsgs(1);
+    if (this->qos.history == QoS::History::KEEP_ALL) {
+        if (this->queuedBytes.fetch_add(msgSize) + msgSize > this->qos.maxBytes ||
+                !this->msgs.push(std::move(queuedMsg))) {
+            this->queuedBytes.fetch_sub(msgSize);
+            this->countQueuedMsgs(-1);
+            return Result::DROPPED;
+        }
+    } else {
+        // Take the place of the oldest msg when full, or wait for the slot to be handed off
+        while (!this->msgs.push(std::move(queuedMsg))) {
+            QueuedMsg oldestMsg;
+            if (!this->msgs.full()) {
+                std::this_thread::yield();
+            } else if (this->msgs.pop(oldestMsg)) {
+                this->countQueuedMsgs(-1);
+                result = Result::OVERWRITTEN;
+            }
+        }
+    }
+
+    this->scheduleMsgHandling();
+    return result;
+}
+
+void Subscription::scheduleMsgHandling() {
+    auto mainContext = this->mainContext.lock();
+    if (mainContext && !this->msgHandlingScheduled.exchange(true)) {
+        asio::post(*mainContext, bindHandlerMemory(this->handlerMemory,
+                                                        [subscription=this->shared_from_this()] {
+            subscription->handleMsgs();
+        }));
+    }
+}
+
+void Subscription::handleMsgs() {
+    // Msgs pushed from now on schedule another task
+    this->msgHandlingScheduled.store(false);
+
+    // Handle at most a queue's worth of msgs so other tasks on the main context get their turn
+    QueuedMsg msg;
+    for (size_t i = 0; i < this->msgs.capacity(); ++i) {
+        if (!this->msgs.pop(msg)) {
+            return;
+        }
+
+        // Only KEEP_ALL subscriptions are bounded by bytes
+        if (this->qos.history == QoS::History::KEEP_ALL) {
+            this->queuedBytes.fetch_sub(msg.msgSize);
+        }
+        this->countQueuedMsgs(-1);
+        this->handleMsg(std::move(msg));
+    }
+
+    if (!this->msgs.empty()) {
+        this->scheduleMsgHandling();
+    }
+}
+
+void Subscription::countQueuedMsgs(int64_t msgs) {
+    if (this->counters) {
+        this->counters->queuedMsgs.fetch_add(msgs, std::memory_order_relaxed);
+    }
+}
+
+void Subscription::handleMsg(QueuedMsg &&msg) {
+    if (msg.publishTime && this->stats) {
+        this->stats->recordLatency(msg.publishTime);
+    }
+
+#ifdef NETWORK_TRACING
+    trace::record(trace::Stage::DISPATCH, msg.queuedTime, trace::now(), this->msgTypeId, msg.sequence,
+                  msg.connectionPort);
+    const trace::Scope traceScope(trace::Stage::HANDLE, this->msgTypeId, msg.sequence);
+#endif
+    this->msgHandler(std::move(msg.msg), msg.msgSize);
+}
+
+} // namespace ntwk
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include <asio/io_context.hpp>
+
+#include <network/Dispatch.h>
+#include <network/HandlerMemory.h>
+#include <network/MsgPtr.h>
+#include <network/MsgTypeId.h>
+#include <network/QoS.h>
+#include <network/msgs/MsgStamp_generated.h>
+
+#include "HandoffQueue.h"
+
+namespace ntwk {
+
+class MsgStatsRecorder;
+struct TopicCounters;
+
+// Msg handler of a msg type subscribed to. Msgs handled on the main context are handed off
+// through a lock-free queue bounded by the QoS of the subscription, and a single task is posted
+// to the main context for each batch of msgs. Msgs dispatched otherwise skip the queue.
+// The latency of stamped msgs is recorded as their handler is called, and msgs waiting for
+// their handler are counted as queued.
+class Subscription : public std::enable_shared_from_this<Subscription> {
+public:
+    using MsgHandler = std::function<void(MsgPtr &&, size_t)>;
+
+    enum class Result {
+        QUEUED,
+        OVERWRITTEN,
+        DROPPED
+    };
+
+    Subscription(MsgTypeId msgTypeId, std::weak_ptr<asio::io_context> mainContext, MsgHandler msgHandler,
+                 const QoS &qos, const Dispatch &dispatch, std::shared_ptr<MsgStatsRecorder> stats=nullptr,
+                 std::shared_ptr<TopicCounters> counters=nullptr);
+
+    // Called on the subscriber's strand, without a stamp for msgs of publishers that have none.
+    // The port of the connection's socket tells msgs of different connections apart in traces.
+    Result push(MsgPtr &&msg, size_t msgSize, const msgs::MsgStamp *msgStamp=nullptr,
+                uint16_t connectionPort=0);
+
+    MsgStatsRecorder *getStats() const {
+        return this->stats.get();
+    }
+
+    TopicCounters *getCounters() const {
+        return this->counters.get();
+    }
+
+private:
+    struct QueuedMsg {
+        MsgPtr msg;
+        size_t msgSize = 0;
+        uint64_t publishTime = 0;
+#ifdef NETWORK_TRACING
+        uint64_t sequence = 0;
+        uint64_t queuedTime = 0;
+        uint16_t connectionPort = 0;
+#endif
+    };
+
+    void scheduleMsgHandling();
+    void handleMsgs();
+    void handleMsg(QueuedMsg &&msg);
+    void countQueuedMsgs(int64_t msgs);
+
+private:
+    MsgTypeId msgTypeId;
+
+    // Msgs queued once the main context is gone are never handled
+    std::weak_ptr<asio::io_context> mainContext;
+    MsgHandler msgHandler;
+    QoS qos;
+    Dispatch dispatch;
+    std::shared_ptr<MsgStatsRecorder> stats;
+    std::shared_ptr<TopicCounters> counters;
+
+    HandoffQueue<QueuedMsg> msgs;
+
+    // Bytes of the queued msgs, only counted for KEEP_ALL subscriptions
+    std::atomic<size_t> queuedBytes;
+    std::atomic<bool> msgHandlingScheduled;
+
+    // Tasks posted to the main context or the executor
+    HandlerMemory handlerMemory;
+};
+
+} // namespace ntwk
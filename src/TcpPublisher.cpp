@@ -1,112 +1,760 @@
 #include <network/TcpPublisher.h>
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <deque>
 #include <system_error>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include <asio/bind_executor.hpp>
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 
+#include <network/HandlerMemory.h>
+#include <network/MsgQueue.h>
 #include <network/Utils.h>
+#include <network/msgs/Handshake_generated.h>
 #include <network/msgs/Header_generated.h>
 #include <network/msgs/MsgCtrl_generated.h>
+#include <network/msgs/MsgStamp_generated.h>
+#include <network/msgs/SharedMemorySlot_generated.h>
+
+#include "IntraProcessChannel.h"
+#include "MetricsCounters.h"
+#include "Protocol.h"
+#include "SharedMemorySegment.h"
+#include "TraceRecorder.h"
+
+namespace {
+
+// Two buffers (header and data) per msg, within the iovec limit of a single gathered write
+constexpr unsigned int MAX_MSGS_PER_WRITE = 32;
+
+} // namespace
 
 namespace ntwk {
 
 struct Msg;
 
-using namespace asio::ip;
-using MsgMap = std::unordered_map<MsgTypeId, Msg>;
+using MsgMap = std::unordered_map<MsgTypeId, MsgQueue<Msg>>;
+
+// Header of a msg followed by its stamp, sent as a single buffer. Subscribers of protocol
+// versions without stamps only get the header.
+struct MsgHeader {
+    msgs::Header header;
+    msgs::MsgStamp stamp;
+
+    MsgHeader(uint32_t msgTypeId, uint32_t msgSize, const msgs::MsgStamp &stamp) :
+        header(msgTypeId, msgSize), stamp(stamp) { }
+};
+
+static_assert(offsetof(MsgHeader, stamp) == sizeof(msgs::Header) &&
+              sizeof(MsgHeader) == sizeof(msgs::Header) + sizeof(msgs::MsgStamp),
+              "The stamp must directly follow the header");
+
+// Copy of a msg in a shared memory slot. The publisher holds the slot until the msg has
+// been announced to every socket attached to the shared memory.
+struct SharedMemoryMsg {
+    std::shared_ptr<SharedMemorySegment> segment;
+    unsigned int slot;
+    MsgHeader header;
+    msgs::SharedMemorySlot slotMsg;
+
+    SharedMemoryMsg(std::shared_ptr<SharedMemorySegment> segment, unsigned int slot,
+                    const MsgHeader &msgHeader) :
+        segment(std::move(segment)), slot(slot),
+        header(msgHeader.header.msg_type_id() | protocol::SHARED_MEMORY_MSG_FLAG,
+               sizeof(msgs::SharedMemorySlot), msgHeader.stamp),
+        slotMsg(slot, msgHeader.header.msg_size()) { }
+
+    ~SharedMemoryMsg() {
+        this->segment->release(this->slot, SharedMemorySegment::PUBLISHER_HOLDER);
+    }
+};
 
 struct Msg {
-    std::shared_ptr<msgs::Header> header;
+    std::shared_ptr<MsgHeader> header;
     std::shared_ptr<flatbuffers::DetachedBuffer> buffer;
+    std::shared_ptr<SharedMemoryMsg> sharedMemoryMsg;
+    TopicCounters *counters;
+#ifdef NETWORK_TRACING
+    uint64_t queuedTime = 0;
+#endif
 };
 
+// Send time of a msg in flight, and the msg whose round trip is traced
+struct InFlightMsg {
+    uint64_t sendTime = 0;
+#ifdef NETWORK_TRACING
+    MsgTypeId msgTypeId{};
+    uint64_t sequence = 0;
+#endif
+};
+
+// Each socket sends its pending msgs in the order they were enqueued, gathering as many as
+// possible into a single write. Newer msgs of the same type overwrite the oldest pending msg
+// or are dropped according to the QoS of the msg type.
+//
+// Once connected, the socket's operations run on its own strand so sockets are served in
+// parallel. The handshake and the fields the publisher uses to fan out msgs belong to the
+// publisher's strand.
 struct TcpPublisher::Socket {
-    tcp::socket socket;
+    transport::Socket socket;
+    HandlerMemory handlerMemory;
+    bool disconnected = false;
+
     MsgMap msgs;
+    std::deque<MsgTypeId> pendingMsgTypeIds;
+
+    std::vector<Msg> sendingMsgs;
+    std::vector<asio::const_buffer> sendBuffers;
+    bool sending = false;
+
+    // Counted once connected. The start of each write and the send times of the msgs in flight,
+    // in a ring as large as the window starting at the oldest msg, time the writes and the
+    // round trip until msgs are acknowledged.
+    std::shared_ptr<ConnectionCounters> counters;
+    uint64_t sendStartTime = 0;
+    std::vector<InFlightMsg> inFlightMsgs;
+    size_t oldestInFlight = 0;
+#ifdef NETWORK_TRACING
+    uint16_t traceConnection = 0;
+#endif
+
+    // Flow control negotiated in the handshake. A legacy subscriber acknowledges
+    // every msg individually, otherwise up to windowSize msgs may be unacknowledged.
+    uint32_t protocolVersion = protocol::LEGACY_VERSION;
+    unsigned int msgsInFlight = 0;
+
+    // Subscribers on the same host are offered the publisher's shared memory and
+    // identify themselves with a holder bit when using its slots
+    int sharedMemoryHolder = -1;
+
+    msgs::Header handshakeHeader;
+    msgs::Handshake handshake;
+    std::vector<uint8_t> ctrlMsg;
+    msgs::Ctrl ctrl;
 
-    explicit Socket(asio::io_context &context) : socket(context) {}
+    // Publisher's strand: subscribers that negotiated subscriptions only get the msg types
+    // they asked for, in shared memory once attached
+    std::unordered_set<MsgTypeId> subscribedMsgTypeIds;
+    bool sharedMemoryAttached = false;
+
+    explicit Socket(asio::io_context &context) : socket(asio::make_strand(context)) {}
+
+    bool isSubscribed(MsgTypeId msgTypeId) const {
+        return this->protocolVersion < protocol::SUBSCRIPTION_VERSION ||
+                this->subscribedMsgTypeIds.count(msgTypeId);
+    }
+
+    size_t getHeaderSize() const {
+        return this->protocolVersion >= protocol::MSG_STAMP_VERSION ? sizeof(MsgHeader) : sizeof(msgs::Header);
+    }
 };
 
 std::shared_ptr<TcpPublisher> TcpPublisher::create(asio::io_context &publisherContext,
-                                                   unsigned short port) {
-    std::shared_ptr<TcpPublisher> publisher(new TcpPublisher(publisherContext, port));
-    publisher->listenForConnections();
+                                                   const std::string &endpoint, unsigned int windowSize) {
+    std::shared_ptr<TcpPublisher> publisher(new TcpPublisher(publisherContext, endpoint, windowSize));
+    asio::post(publisher->strand, [publisher]{
+        publisher->listenForConnections();
+    });
     return publisher;
 }
 
-TcpPublisher::TcpPublisher(asio::io_context &publisherContext, unsigned short port) :
-    publisherContext(publisherContext),
-    socketAcceptor(publisherContext, tcp::endpoint(tcp::v4(), port)) { }
+TcpPublisher::TcpPublisher(asio::io_context &publisherContext, const std::string &endpoint,
+                           unsigned int windowSize) :
+    publisherContext(publisherContext), strand(asio::make_strand(publisherContext)),
+    endpoint(transport::makeEndpoint(endpoint)),
+    socketAcceptor(transport::makeAcceptor(this->strand, this->endpoint)),
+    windowSize(std::max(windowSize, 1u)),
+    intraProcessChannel(IntraProcessChannel::advertise(transport::getLocalName(this->endpoint))),
+    sharedMemoryHolders(0), detachedSharedMemoryHolders(0) { }
+
+TcpPublisher::~TcpPublisher() {
+    this->intraProcessChannel->close();
+    if (this->socketAcceptor.is_open()) {
+        transport::remove(this->endpoint);
+    }
+}
+
+std::future<void> TcpPublisher::close() {
+    this->intraProcessChannel->close();
+
+    // Closed once the tasks disconnecting the sockets on their strands are done
+    std::shared_ptr<std::promise<void>> closed(new std::promise<void>(), [](std::promise<void> *promise) {
+        promise->set_value();
+        delete promise;
+    });
+    auto future = closed->get_future();
+    asio::post(this->strand, [publisher=this->shared_from_this(), closed] {
+        std::error_code error;
+        publisher->socketAcceptor.close(error);
+        transport::remove(publisher->endpoint);
+
+        for (auto &socket : publisher->connectedSockets) {
+            asio::post(socket->socket.get_executor(), [publisher, socket, closed] {
+                publisher->disconnect(socket);
+            });
+        }
+    });
+    return future;
+}
 
 void TcpPublisher::listenForConnections() {
-    auto socket = std::make_unique<Socket>(this->publisherContext);
+    auto socket = std::make_shared<Socket>(this->publisherContext);
     auto pSocket = socket.get();
 
-    // Save connected sockets for later publishing and listen for more connections
+    // Negotiate the protocol with connected sockets and listen for more connections
     this->socketAcceptor.async_accept(pSocket->socket,
                                       [publisher=this->shared_from_this(),
                                        socket=std::move(socket)](const auto &error) mutable {
+        if (error == asio::error::operation_aborted) {
+            return;
+        }
+
         if (!error) {
-            publisher->connectedSockets.emplace_back(std::move(socket));
+            transport::configure(socket->socket);
+            sendHandshake(PublisherPtr(publisher), std::move(socket));
         }
         publisher->listenForConnections();
     });
 }
 
+void TcpPublisher::sendHandshake(PublisherPtr &&publisher, SocketPtr &&socket) {
+    auto pSocket = socket.get();
+    pSocket->handshakeHeader = msgs::Header(toUnderlyingType(MsgTypeId::MSG_CTRL),
+                                            sizeof(msgs::Handshake));
+    pSocket->handshake = msgs::Handshake(protocol::VERSION, publisher->windowSize);
+
+    const std::array<asio::const_buffer, 2> buffers{
+        asio::buffer(&pSocket->handshakeHeader, sizeof(msgs::Header)),
+        asio::buffer(&pSocket->handshake, sizeof(msgs::Handshake))
+    };
+    auto &strand = publisher->strand;
+    asio::async_write(pSocket->socket, buffers,
+                      asio::bind_executor(strand, [publisher=std::move(publisher), socket=std::move(socket)]
+                                          (const auto &error, auto) mutable {
+        if (!error) {
+            receiveHandshake(std::move(publisher), std::move(socket));
+        }
+    }));
+}
+
+void TcpPublisher::receiveHandshake(PublisherPtr &&publisher, SocketPtr &&socket) {
+    // A legacy subscriber treats the handshake as an ordinary msg and replies with a
+    // single ACK byte, which doubles as the first byte of a msgs::Ctrl.
+    auto pSocket = socket.get();
+    auto pCtrl = reinterpret_cast<uint8_t *>(&pSocket->ctrl);
+    auto &strand = publisher->strand;
+    asio::async_read(pSocket->socket, asio::buffer(pCtrl, 1),
+                     asio::bind_executor(strand, [publisher=std::move(publisher), socket=std::move(socket), pCtrl]
+                                         (const auto &error, auto) mutable {
+        if (error) {
+            return;
+        }
+
+        if (socket->ctrl.ctrl() == msgs::MsgCtrl::ACK) {
+            socket->protocolVersion = protocol::LEGACY_VERSION;
+            addConnectedSocket(std::move(publisher), std::move(socket));
+            return;
+        }
+
+        if (socket->ctrl.ctrl() != msgs::MsgCtrl::HANDSHAKE) {
+            return;
+        }
+
+        auto pSocket = socket.get();
+        auto &strand = publisher->strand;
+        asio::async_read(pSocket->socket, asio::buffer(pCtrl + 1, sizeof(msgs::Ctrl) - 1),
+                         asio::bind_executor(strand, [publisher=std::move(publisher), socket=std::move(socket)]
+                                             (const auto &error, auto) mutable {
+            if (!error) {
+                socket->protocolVersion = std::min(socket->ctrl.value(), protocol::VERSION);
+                offerSharedMemory(std::move(publisher), std::move(socket));
+            }
+        }));
+    }));
+}
+
+void TcpPublisher::offerSharedMemory(PublisherPtr &&publisher, SocketPtr &&socket) {
+    // Only subscribers on the same host can map the shared memory
+    std::error_code error;
+    const auto remoteEndpoint = socket->socket.remote_endpoint(error);
+    if (error || socket->protocolVersion < protocol::SHARED_MEMORY_VERSION ||
+            !transport::isLocal(remoteEndpoint) ||
+            !publisher->acquireSharedMemoryHolder(*socket)) {
+        addConnectedSocket(std::move(publisher), std::move(socket));
+        return;
+    }
+
+    // Announce the shared memory name, the subscriber confirms once it is mapped
+    const auto &name = publisher->sharedMemory->getName();
+    const msgs::Ctrl offer(msgs::MsgCtrl::SHARED_MEMORY_SEGMENT, socket->sharedMemoryHolder);
+    auto pSocket = socket.get();
+    pSocket->ctrlMsg.resize(sizeof(msgs::Ctrl) + name.size());
+    std::memcpy(pSocket->ctrlMsg.data(), &offer, sizeof(msgs::Ctrl));
+    std::memcpy(pSocket->ctrlMsg.data() + sizeof(msgs::Ctrl), name.data(), name.size());
+    pSocket->handshakeHeader = msgs::Header(toUnderlyingType(MsgTypeId::MSG_CTRL),
+                                            pSocket->ctrlMsg.size());
+
+    const std::array<asio::const_buffer, 2> buffers{
+        asio::buffer(&pSocket->handshakeHeader, sizeof(msgs::Header)),
+        asio::buffer(pSocket->ctrlMsg)
+    };
+    auto &strand = publisher->strand;
+    asio::async_write(pSocket->socket, buffers,
+                      asio::bind_executor(strand, [publisher=std::move(publisher), socket=std::move(socket)]
+                                          (const auto &error, auto) mutable {
+        if (error) {
+            publisher->disconnect(socket);
+            return;
+        }
+
+        addConnectedSocket(std::move(publisher), std::move(socket));
+    }));
+}
+
+void TcpPublisher::addConnectedSocket(PublisherPtr &&publisher, SocketPtr &&socket) {
+    // The publisher was closed during the handshake
+    if (!publisher->socketAcceptor.is_open()) {
+        publisher->disconnect(socket);
+        return;
+    }
+
+    std::error_code error;
+    const auto remoteEndpoint = socket->socket.remote_endpoint(error);
+    socket->counters = std::make_shared<ConnectionCounters>(transport::getUri(remoteEndpoint));
+#ifdef NETWORK_TRACING
+    socket->traceConnection = error ? 0 : transport::getPort(remoteEndpoint);
+#endif
+    socket->inFlightMsgs.resize(publisher->windowSize);
+    {
+        std::lock_guard<std::mutex> lock(publisher->metricsMutex);
+        publisher->connectionCounters.push_back(socket->counters);
+    }
+
+    publisher->connectedSockets.emplace_back(socket);
+    if (socket->protocolVersion >= protocol::WINDOWED_ACK_VERSION) {
+        auto pSocket = socket.get();
+        asio::post(pSocket->socket.get_executor(),
+                   [publisher=std::move(publisher), socket=std::move(socket)]() mutable {
+            receiveCtrl(std::move(publisher), std::move(socket));
+        });
+    }
+}
+
+bool TcpPublisher::acquireSharedMemoryHolder(Socket &socket) {
+    if (!this->sharedMemory) {
+        try {
+            this->sharedMemory = SharedMemorySegment::create(protocol::SHARED_MEMORY_SLOT_COUNT,
+                                                             protocol::SHARED_MEMORY_SLOT_SIZE);
+        } catch (const std::system_error &) {
+            return false;
+        }
+    }
+
+    this->reclaimSharedMemoryHolders();
+    for (unsigned int holder = 0; holder < SharedMemorySegment::MAX_SUBSCRIBER_HOLDERS; ++holder) {
+        const auto holderBit = 1ull << holder;
+        if (!((this->sharedMemoryHolders | this->detachedSharedMemoryHolders) & holderBit)) {
+            this->sharedMemoryHolders |= holderBit;
+            socket.sharedMemoryHolder = holder;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TcpPublisher::reclaimSharedMemoryHolders() {
+    // Reclaim the slots of a disconnected subscriber once it no longer maps the segment, as
+    // it releases its slots until then
+    for (unsigned int holder = 0; holder < SharedMemorySegment::MAX_SUBSCRIBER_HOLDERS; ++holder) {
+        const auto holderBit = 1ull << holder;
+        if ((this->detachedSharedMemoryHolders & holderBit) && !this->sharedMemory->isMapped(holder)) {
+            this->sharedMemory->releaseAll(holder);
+            this->detachedSharedMemoryHolders &= ~holderBit;
+        }
+    }
+}
+
 void TcpPublisher::publish(MsgTypeId msgTypeId,
                            std::shared_ptr<flatbuffers::DetachedBuffer> msg) {
-    asio::post(this->publisherContext,
-               [publisher=this->shared_from_this(), msgTypeId, msg=std::move(msg)]() mutable {
-        auto header = std::make_shared<msgs::Header>(toUnderlyingType(msgTypeId), msg->size());
+    // Subscribers in the same process share the msg directly
+    this->intraProcessChannel->publish(msgTypeId, msg);
+
+    asio::post(this->strand, [publisher=this->shared_from_this(), msgTypeId, msg=std::move(msg),
+                              publishTime=protocol::getPublishTime()]() mutable {
+        const msgs::MsgStamp stamp(publishTime, publisher->sequenceNumbers[msgTypeId]++);
+        auto header = std::make_shared<MsgHeader>(toUnderlyingType(msgTypeId), msg->size(), stamp);
+        auto sharedMemoryMsg = publisher->copyToSharedMemory(*header, *msg);
+        const auto &qos = publisher->qos[msgTypeId];
+        auto &counters = publisher->getTopicCounters(msgTypeId);
 
         for (auto &socket : publisher->connectedSockets) {
-            auto &msgBuffer = socket->msgs[msgTypeId];
-
-            // Schedule msg to be sent if available
-            if (!msgBuffer.buffer)  {
-                asio::post(publisher->publisherContext,
-                           [publisher, socket, msgTypeId]() mutable {
-                    TcpPublisher::sendMsg(std::move(publisher), std::move(socket),
-                                          msgTypeId);
-                });
+            if (!socket->isSubscribed(msgTypeId)) {
+                continue;
             }
 
-            // Enqueue msg to send
-            msgBuffer.header = header;
-            msgBuffer.buffer = msg;
+            Msg socketMsg{header, msg, socket->sharedMemoryAttached ? sharedMemoryMsg : nullptr, &counters};
+            asio::post(socket->socket.get_executor(),
+                       [publisher, socket, msgTypeId, qos, msg=std::move(socketMsg)]() mutable {
+                if (socket->disconnected) {
+                    return;
+                }
+
+                auto msgQueue = socket->msgs.find(msgTypeId);
+                if (msgQueue == socket->msgs.end()) {
+                    msgQueue = socket->msgs.emplace(msgTypeId, MsgQueue<Msg>(qos)).first;
+                }
+
+                // Enqueue msg to send and schedule it unless it took the place of an older msg
+                auto &counters = *msg.counters;
+                const auto msgSize = msg.buffer->size();
+#ifdef NETWORK_TRACING
+                msg.queuedTime = trace::now();
+#endif
+                const auto queuedMsgs = msgQueue->second.size();
+                const auto result = msgQueue->second.push(std::move(msg), msgSize);
+                const auto addedMsgs = static_cast<int64_t>(msgQueue->second.size()) - static_cast<int64_t>(queuedMsgs);
+                counters.queuedMsgs.fetch_add(addedMsgs, std::memory_order_relaxed);
+                socket->counters->queuedMsgs.fetch_add(addedMsgs, std::memory_order_relaxed);
+                if (result == MsgQueue<Msg>::Result::QUEUED) {
+                    socket->pendingMsgTypeIds.push_back(msgTypeId);
+                } else {
+                    auto &lostMsgs = result == MsgQueue<Msg>::Result::OVERWRITTEN ?
+                            counters.overwrittenMsgs : counters.droppedMsgs;
+                    lostMsgs.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                sendMsg(publisher, socket);
+            });
         }
+
+#ifdef NETWORK_TRACING
+        trace::record(trace::Stage::PUBLISH, publishTime, trace::now(), msgTypeId, stamp.sequence());
+#endif
     });
 }
 
-void TcpPublisher::sendMsg(PublisherPtr &&publisher, SocketPtr &&socket,
-                           MsgTypeId msgTypeId) {
-    auto &msg = socket->msgs[msgTypeId];
+void TcpPublisher::setQoS(MsgTypeId msgTypeId, const QoS &qos) {
+    asio::post(this->strand, [publisher=this->shared_from_this(), msgTypeId, qos] {
+        publisher->qos[msgTypeId] = qos;
+        for (auto &socket : publisher->connectedSockets) {
+            asio::post(socket->socket.get_executor(), [socket, msgTypeId, qos] {
+                auto msgQueue = socket->msgs.find(msgTypeId);
+                if (msgQueue != socket->msgs.end()) {
+                    msgQueue->second.setQoS(qos);
+                }
+            });
+        }
+    });
+}
+
+QueueStats TcpPublisher::getQueueStats(MsgTypeId msgTypeId) const {
+    std::lock_guard<std::mutex> lock(this->metricsMutex);
+    auto counters = this->topicCounters.find(msgTypeId);
+    if (counters == this->topicCounters.cend()) {
+        return QueueStats();
+    }
+
+    QueueStats stats;
+    stats.overwrittenMsgs = counters->second->overwrittenMsgs.load(std::memory_order_relaxed);
+    stats.droppedMsgs = counters->second->droppedMsgs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+PublisherMetrics TcpPublisher::getMetrics() const {
+    PublisherMetrics metrics;
+    std::lock_guard<std::mutex> lock(this->metricsMutex);
+    for (const auto &counters : this->topicCounters) {
+        metrics.topics.push_back(counters.second->getMetrics(counters.first));
+    }
+    for (const auto &counters : this->connectionCounters) {
+        metrics.connections.push_back(counters->getMetrics());
+    }
+    return metrics;
+}
+
+TopicCounters &TcpPublisher::getTopicCounters(MsgTypeId msgTypeId) {
+    auto counters = this->topicCounters.find(msgTypeId);
+    if (counters == this->topicCounters.end()) {
+        std::lock_guard<std::mutex> lock(this->metricsMutex);
+        counters = this->topicCounters.emplace(msgTypeId, std::make_unique<TopicCounters>()).first;
+    }
+    return *counters->second;
+}
+
+void TcpPublisher::sendMsg(const PublisherPtr &publisher, const SocketPtr &socket) {
+    if (socket->disconnected || socket->sending || socket->pendingMsgTypeIds.empty() ||
+            socket->msgsInFlight >= publisher->windowSize) {
+        return;
+    }
+
+    // Gather as many pending msgs as the window allows into a single write. Legacy
+    // subscribers acknowledge every msg so they only get one msg at a time.
+    const auto maxMsgs = socket->protocolVersion >= protocol::WINDOWED_ACK_VERSION ?
+            std::min(publisher->windowSize - socket->msgsInFlight, MAX_MSGS_PER_WRITE) : 1u;
 
-    try {
-        // Send msg header and data
-        asio::write(socket->socket, asio::buffer(msg.header.get(), sizeof(msgs::Header)));
-        asio::write(socket->socket, asio::buffer(msg.buffer->data(), msg.buffer->size()));
+    // Take ownership of the msgs so newer msgs of the same type can be enqueued meanwhile
+    while (!socket->pendingMsgTypeIds.empty() && socket->sendingMsgs.size() < maxMsgs) {
+        // Msgs may have been discarded when the QoS was lowered
+        auto &msgQueue = socket->msgs[socket->pendingMsgTypeIds.front()];
+        socket->pendingMsgTypeIds.pop_front();
+        if (msgQueue.empty()) {
+            continue;
+        }
 
-        // Wait for ack
-        msgs::MsgCtrl msgCtrl;
-        asio::read(socket->socket, asio::buffer(&msgCtrl, sizeof(msgs::MsgCtrl)));
-        if (msgCtrl != msgs::MsgCtrl::ACK) {
-            throw std::system_error(std::make_error_code(std::io_errc::stream));
+        auto msg = msgQueue.pop();
+        msg.counters->queuedMsgs.fetch_sub(1, std::memory_order_relaxed);
+        socket->counters->queuedMsgs.fetch_sub(1, std::memory_order_relaxed);
+#ifdef NETWORK_TRACING
+        trace::record(trace::Stage::QUEUE, msg.queuedTime, trace::now(),
+                      static_cast<MsgTypeId>(msg.header->header.msg_type_id()), msg.header->stamp.sequence(),
+                      socket->traceConnection);
+#endif
+        if (msg.sharedMemoryMsg) {
+            // Only announce the slot, the subscriber releases it once the msg is handled
+            auto &sharedMemoryMsg = *msg.sharedMemoryMsg;
+            sharedMemoryMsg.segment->hold(sharedMemoryMsg.slot, socket->sharedMemoryHolder);
+            socket->sendBuffers.emplace_back(asio::buffer(&sharedMemoryMsg.header, socket->getHeaderSize()));
+            socket->sendBuffers.emplace_back(asio::buffer(&sharedMemoryMsg.slotMsg,
+                                                          sizeof(msgs::SharedMemorySlot)));
+        } else {
+            socket->sendBuffers.emplace_back(asio::buffer(msg.header.get(), socket->getHeaderSize()));
+            socket->sendBuffers.emplace_back(asio::buffer(msg.buffer->data(), msg.buffer->size()));
+        }
+        socket->sendingMsgs.emplace_back(std::move(msg));
+    }
+    if (socket->sendingMsgs.empty()) {
+        return;
+    }
+    socket->sending = true;
+    socket->sendStartTime = protocol::getPublishTime();
+
+    // Msgs are in flight from the start of the write, as their acks may be handled before
+    // the write completes
+    if (socket->protocolVersion >= protocol::WINDOWED_ACK_VERSION) {
+        auto &inFlightMsgs = socket->inFlightMsgs;
+        for (size_t i = 0; i < socket->sendingMsgs.size(); ++i) {
+            auto &inFlightMsg = inFlightMsgs[(socket->oldestInFlight + socket->msgsInFlight + i) % inFlightMsgs.size()];
+            inFlightMsg.sendTime = socket->sendStartTime;
+#ifdef NETWORK_TRACING
+            const auto &header = *socket->sendingMsgs[i].header;
+            inFlightMsg.msgTypeId = static_cast<MsgTypeId>(header.header.msg_type_id());
+            inFlightMsg.sequence = header.stamp.sequence();
+#endif
+        }
+        socket->msgsInFlight += static_cast<unsigned int>(socket->sendingMsgs.size());
+    }
+
+    // Send msg headers and data
+    auto pSocket = socket.get();
+    asio::async_write(pSocket->socket, pSocket->sendBuffers,
+                      bindHandlerMemory(pSocket->handlerMemory, [publisher=publisher, socket=socket]
+                      (const auto &error, auto bytesSent) mutable {
+        auto &counters = *socket->counters;
+        const auto sendEndTime = protocol::getPublishTime();
+        counters.bytes.fetch_add(bytesSent, std::memory_order_relaxed);
+        counters.sendTime.fetch_add(sendEndTime - socket->sendStartTime, std::memory_order_relaxed);
+        if (!error) {
+            counters.msgs.fetch_add(socket->sendingMsgs.size(), std::memory_order_relaxed);
+            for (const auto &msg : socket->sendingMsgs) {
+                msg.counters->msgs.fetch_add(1, std::memory_order_relaxed);
+                msg.counters->bytes.fetch_add(msg.buffer->size(), std::memory_order_relaxed);
+#ifdef NETWORK_TRACING
+                trace::record(trace::Stage::WRITE, socket->sendStartTime, sendEndTime,
+                              static_cast<MsgTypeId>(msg.header->header.msg_type_id()), msg.header->stamp.sequence(),
+                              socket->traceConnection);
+#endif
+            }
+        }
+        socket->sendingMsgs.clear();
+        socket->sendBuffers.clear();
+
+        if (error) {
+            publisher->disconnect(socket);
+            return;
+        }
+
+        if (socket->protocolVersion >= protocol::WINDOWED_ACK_VERSION) {
+            // Keep sending until the window is full, acks are received independently
+            socket->sending = false;
+            sendMsg(publisher, socket);
+        } else {
+            receiveAck(std::move(publisher), std::move(socket));
+        }
+    }));
+}
+
+void TcpPublisher::receiveAck(PublisherPtr &&publisher, SocketPtr &&socket) {
+    auto pSocket = socket.get();
+    auto pCtrl = reinterpret_cast<uint8_t *>(&pSocket->ctrl);
+    asio::async_read(pSocket->socket, asio::buffer(pCtrl, sizeof(msgs::MsgCtrl)),
+                     bindHandlerMemory(pSocket->handlerMemory, [publisher=std::move(publisher), socket=std::move(socket)]
+                     (const auto &error, auto) mutable {
+        if (error || socket->ctrl.ctrl() != msgs::MsgCtrl::ACK) {
+            publisher->disconnect(socket);
+            return;
         }
 
-    } catch (...) {
-        auto iter = std::find_if(publisher->connectedSockets.cbegin(), publisher->connectedSockets.cend(),
-                                 [socket=socket.get()](const auto &s){ return s.get() == socket; });
+        socket->counters->addAckRoundTripTime(protocol::getPublishTime() - socket->sendStartTime);
+        socket->sending = false;
+        sendMsg(publisher, socket);
+    }));
+}
+
+void TcpPublisher::receiveCtrl(PublisherPtr &&publisher, SocketPtr &&socket) {
+    auto pSocket = socket.get();
+    asio::async_read(pSocket->socket, asio::buffer(&pSocket->ctrl, sizeof(msgs::Ctrl)),
+                     bindHandlerMemory(pSocket->handlerMemory, [publisher=std::move(publisher), socket=std::move(socket)]
+                     (const auto &error, auto) mutable {
+        if (error) {
+            publisher->disconnect(socket);
+            return;
+        }
+
+        switch (socket->ctrl.ctrl()) {
+        case msgs::MsgCtrl::ACK_CUMULATIVE:
+            if (socket->ctrl.value() > socket->msgsInFlight) {
+                publisher->disconnect(socket);
+                return;
+            }
+            socket->msgsInFlight -= socket->ctrl.value();
+            if (socket->ctrl.value() > 0) {
+                // Time the round trip of the newest msg acknowledged
+                auto &inFlightMsgs = socket->inFlightMsgs;
+                const auto ackTime = protocol::getPublishTime();
+                const auto newestAcked = (socket->oldestInFlight + socket->ctrl.value() - 1) % inFlightMsgs.size();
+                socket->counters->addAckRoundTripTime(ackTime - inFlightMsgs[newestAcked].sendTime);
+#ifdef NETWORK_TRACING
+                for (uint32_t i = 0; i < socket->ctrl.value(); ++i) {
+                    const auto &inFlightMsg = inFlightMsgs[(socket->oldestInFlight + i) % inFlightMsgs.size()];
+                    trace::record(trace::Stage::ACK, inFlightMsg.sendTime, ackTime, inFlightMsg.msgTypeId,
+                                  inFlightMsg.sequence, socket->traceConnection);
+                }
+#endif
+                socket->oldestInFlight = (newestAcked + 1) % inFlightMsgs.size();
+            }
+            sendMsg(publisher, socket);
+            break;
+
+        case msgs::MsgCtrl::SHARED_MEMORY_ATTACHED:
+            asio::post(publisher->strand, [socket, attached=socket->ctrl.value() != 0] {
+                socket->sharedMemoryAttached = socket->sharedMemoryHolder >= 0 && attached;
+            });
+            break;
+
+        case msgs::MsgCtrl::SUBSCRIBE:
+            if (socket->ctrl.value() > protocol::MAX_SUBSCRIBED_MSG_TYPES) {
+                publisher->disconnect(socket);
+                return;
+            }
+            receiveSubscription(std::move(publisher), std::move(socket));
+            return;
+
+        default:
+            publisher->disconnect(socket);
+            return;
+        }
+
+        receiveCtrl(std::move(publisher), std::move(socket));
+    }));
+}
+
+void TcpPublisher::receiveSubscription(PublisherPtr &&publisher, SocketPtr &&socket) {
+    auto pSocket = socket.get();
+    pSocket->ctrlMsg.resize(pSocket->ctrl.value() * sizeof(uint32_t));
+    asio::async_read(pSocket->socket, asio::buffer(pSocket->ctrlMsg),
+                     bindHandlerMemory(pSocket->handlerMemory, [publisher=std::move(publisher), socket=std::move(socket)]
+                     (const auto &error, auto) mutable {
+        if (error) {
+            publisher->disconnect(socket);
+            return;
+        }
+
+        // Each subscription replaces the previous one
+        std::unordered_set<MsgTypeId> msgTypeIds;
+        for (size_t i = 0; i < socket->ctrlMsg.size(); i += sizeof(uint32_t)) {
+            uint32_t msgTypeId;
+            std::memcpy(&msgTypeId, socket->ctrlMsg.data() + i, sizeof(uint32_t));
+            msgTypeIds.insert(static_cast<MsgTypeId>(msgTypeId));
+        }
+        asio::post(publisher->strand, [socket, msgTypeIds=std::move(msgTypeIds)]() mutable {
+            socket->subscribedMsgTypeIds = std::move(msgTypeIds);
+        });
+
+        receiveCtrl(std::move(publisher), std::move(socket));
+    }));
+}
+
+std::shared_ptr<SharedMemoryMsg> TcpPublisher::copyToSharedMemory(const MsgHeader &msgHeader,
+                                                                   const flatbuffers::DetachedBuffer &msg) {
+    const auto msgTypeId = static_cast<MsgTypeId>(msgHeader.header.msg_type_id());
+    const auto attached = std::any_of(this->connectedSockets.cbegin(), this->connectedSockets.cend(),
+                                      [msgTypeId](const auto &socket){
+        return socket->sharedMemoryAttached && socket->isSubscribed(msgTypeId);
+    });
+    if (!attached || msg.size() > this->sharedMemory->getSlotSize()) {
+        return nullptr;
+    }
+
+    // Fall back to sending the msg through the socket while all slots are in use
+    auto slot = this->sharedMemory->acquireSlot();
+    if (slot < 0 && this->detachedSharedMemoryHolders) {
+        this->reclaimSharedMemoryHolders();
+        slot = this->sharedMemory->acquireSlot();
+    }
+    if (slot < 0) {
+        return nullptr;
+    }
+
+    std::memcpy(this->sharedMemory->getSlotData(slot), msg.data(), msg.size());
+    return std::make_shared<SharedMemoryMsg>(this->sharedMemory, slot, msgHeader);
+}
+
+void TcpPublisher::disconnect(const SocketPtr &socket) {
+    // Called on the socket's strand, which stops using the socket's shared memory slots
+    if (socket->disconnected) {
+        return;
+    }
+    socket->disconnected = true;
+
+    std::error_code error;
+    socket->socket.close(error);
+
+    // Msgs that will not be sent are no longer queued
+    for (auto &msgQueue : socket->msgs) {
+        while (!msgQueue.second.empty()) {
+            msgQueue.second.pop().counters->queuedMsgs.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    socket->pendingMsgTypeIds.clear();
+
+    asio::post(this->strand, [publisher=this->shared_from_this(), socket] {
+        auto iter = std::find(publisher->connectedSockets.cbegin(), publisher->connectedSockets.cend(),
+                              socket);
         if (iter != publisher->connectedSockets.cend()) {
             publisher->connectedSockets.erase(iter);
         }
-    }
 
-    msg.header.reset();
-    msg.buffer.reset();
+        if (socket->counters) {
+            std::lock_guard<std::mutex> lock(publisher->metricsMutex);
+            publisher->connectionCounters.remove(socket->counters);
+        }
+
+        // The slots still held by the subscriber are reclaimed once it unmapped the segment
+        if (socket->sharedMemoryHolder >= 0) {
+            const auto holderBit = 1ull << socket->sharedMemoryHolder;
+            publisher->sharedMemoryHolders &= ~holderBit;
+            publisher->detachedSharedMemoryHolders |= holderBit;
+            socket->sharedMemoryAttached = false;
+            publisher->reclaimSharedMemoryHolders();
+        }
+    });
 }
 
 } // namespace ntwk
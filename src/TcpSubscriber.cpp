@@ -1,14 +1,29 @@
 #include <network/TcpSubscriber.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstring>
+#include <string>
 #include <system_error>
+#include <vector>
 
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 
 #include <network/Utils.h>
+#include <network/msgs/Handshake_generated.h>
 #include <network/msgs/Header_generated.h>
 #include <network/msgs/MsgCtrl_generated.h>
+#include <network/msgs/SharedMemorySlot_generated.h>
+
+#include "IntraProcessChannel.h"
+#include "MetricsCounters.h"
+#include "MsgStatsRecorder.h"
+#include "Protocol.h"
+#include "ReceiveBufferPool.h"
+#include "SharedMemorySegment.h"
+#include "Subscription.h"
 
 namespace {
 
@@ -18,28 +33,136 @@ constexpr auto SOCKET_RECONNECT_WAIT_DURATION = std::chrono::milliseconds(30);
 
 namespace ntwk {
 
-using namespace asio::ip;
-
-std::shared_ptr<TcpSubscriber> TcpSubscriber::create(asio::io_context &mainContext,
-                                                     asio::io_context &subscriberContext,
-                                                     const std::string &host,
-                                                     unsigned short port) {
+std::shared_ptr<TcpSubscriber> TcpSubscriber::create(const std::shared_ptr<asio::io_context> &mainContext,
+                                                     const std::shared_ptr<asio::io_context> &subscriberContext,
+                                                     const std::string &endpoint) {
     std::shared_ptr<TcpSubscriber> subscriber(new TcpSubscriber(mainContext, subscriberContext,
-                                                                host, port));
-    connect(subscriber);
+                                                                endpoint));
+    asio::post(subscriber->strand, [subscriber]{
+        connect(subscriber);
+    });
     return subscriber;
 }
 
-TcpSubscriber::TcpSubscriber(asio::io_context &mainContext, asio::io_context &subscriberContext,
-                             const std::string &host, unsigned short port) :
-    mainContext(mainContext), subscriberContext(subscriberContext),
-    socket(subscriberContext), endpoint(make_address(host), port) {}
+TcpSubscriber::TcpSubscriber(const std::shared_ptr<asio::io_context> &mainContext,
+                             const std::shared_ptr<asio::io_context> &subscriberContext,
+                             const std::string &endpoint) :
+    mainContext(mainContext), strand(asio::make_strand(*subscriberContext)),
+    weakSubscriberContext(subscriberContext), socket(this->strand),
+    endpoint(transport::makeEndpoint(endpoint)), closed(false),
+    receiveBuffers(std::make_shared<ReceiveBufferPool>()),
+    connectionCounters(std::make_shared<ConnectionCounters>(transport::getUri(this->endpoint))),
+    sendStartTime(0), connection(0), connectionPort(0),
+    protocolVersion(protocol::LEGACY_VERSION), handshakePending(false), ackInterval(1), unackedMsgs(0), sendingCtrl(false), sharedMemoryHolder(0),
+    intraProcessSubscriberId(0) {}
+
+void TcpSubscriber::subscribe(MsgTypeId msgTypeId, MsgHandler msgHandler, const QoS &qos,
+                              const Dispatch &dispatch) {
+    this->subscribe(msgTypeId, SizedMsgHandler([msgHandler=std::move(msgHandler)](MsgPtr &&msg, size_t) {
+        msgHandler(std::move(msg));
+    }), qos, dispatch);
+}
+
+void TcpSubscriber::subscribe(MsgTypeId msgTypeId, SizedMsgHandler msgHandler, const QoS &qos,
+                              const Dispatch &dispatch) {
+    std::shared_ptr<MsgStatsRecorder> stats;
+    std::shared_ptr<TopicCounters> counters;
+    {
+        std::lock_guard<std::mutex> lock(this->statsMutex);
+        auto &recorder = this->msgStats[toUnderlyingType(msgTypeId)];
+        if (!recorder) {
+            recorder = std::make_shared<MsgStatsRecorder>();
+        }
+        stats = recorder;
+
+        auto &topicCounters = this->topicCounters[toUnderlyingType(msgTypeId)];
+        if (!topicCounters) {
+            topicCounters = std::make_shared<TopicCounters>();
+        }
+        counters = topicCounters;
+    }
+
+    auto subscription = std::make_shared<Subscription>(msgTypeId, this->mainContext, std::move(msgHandler),
+                                                       qos, dispatch, std::move(stats), std::move(counters));
+
+    asio::post(this->strand,
+               [subscriber=this->shared_from_this(), msgTypeId=toUnderlyingType(msgTypeId),
+                subscription=std::move(subscription)]() mutable {
+        subscriber->subscriptions.insert(msgTypeId, std::move(subscription));
+
+        const auto inserted = subscriber->subscribedMsgTypeIds.insert(msgTypeId).second;
+        auto channel = subscriber->intraProcessChannel.lock();
+        if (inserted && channel) {
+            channel->subscribe(subscriber->intraProcessSubscriberId, static_cast<MsgTypeId>(msgTypeId));
+        }
+        if (inserted && subscriber->protocolVersion >= protocol::SUBSCRIPTION_VERSION) {
+            subscriber->queueSubscription();
+            sendCtrl(std::move(subscriber));
+        }
+    });
+}
+
+QueueStats TcpSubscriber::getQueueStats(MsgTypeId msgTypeId) const {
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    auto counters = this->topicCounters.find(toUnderlyingType(msgTypeId));
+    if (counters == this->topicCounters.cend()) {
+        return QueueStats();
+    }
+
+    QueueStats stats;
+    stats.overwrittenMsgs = counters->second->overwrittenMsgs.load(std::memory_order_relaxed);
+    stats.droppedMsgs = counters->second->droppedMsgs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+MsgStats TcpSubscriber::getMsgStats(MsgTypeId msgTypeId) const {
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    auto stats = this->msgStats.find(toUnderlyingType(msgTypeId));
+    return stats != this->msgStats.cend() ? stats->second->getStats() : MsgStats();
+}
+
+SubscriberMetrics TcpSubscriber::getMetrics() const {
+    SubscriberMetrics metrics;
+    metrics.connection = this->connectionCounters->getMetrics();
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    for (const auto &counters : this->topicCounters) {
+        metrics.topics.push_back(counters.second->getMetrics(static_cast<MsgTypeId>(counters.first)));
+    }
+    return metrics;
+}
+
+std::future<void> TcpSubscriber::close() {
+    auto closed = std::make_shared<std::promise<void>>();
+    auto future = closed->get_future();
+    asio::post(this->strand, [subscriber=this->shared_from_this(), closed] {
+        subscriber->closed = true;
+        subscriber->subscriptions.clear();
+        if (subscriber->socketReconnectTimer) {
+            subscriber->socketReconnectTimer->cancel();
+        }
+
+        auto channel = subscriber->intraProcessChannel.lock();
+        if (channel) {
+            channel->unsubscribe(subscriber->intraProcessSubscriberId);
+        }
 
-void TcpSubscriber::subscribe(MsgTypeId msgTypeId, MsgHandler msgHandler) {
-    this->msgHandlers[toUnderlyingType(msgTypeId)] = std::move(msgHandler);
+        std::error_code error;
+        subscriber->socket.close(error);
+        closed->set_value();
+    });
+    return future;
 }
 
 void TcpSubscriber::connect(std::shared_ptr<TcpSubscriber> subscriber) {
+    if (subscriber->closed) {
+        return;
+    }
+
+    // Bypass the socket for publishers in the same process
+    if (transport::isLocal(subscriber->endpoint) && connectIntraProcess(subscriber)) {
+        return;
+    }
+
     auto pSubscriber = subscriber.get();
 
     pSubscriber->socket.async_connect(pSubscriber->endpoint,
@@ -47,78 +170,329 @@ void TcpSubscriber::connect(std::shared_ptr<TcpSubscriber> subscriber) {
         if (error) {
             subscriber->socket.close();
 
-            subscriber->socketReconnectTimer = std::make_unique<asio::steady_timer>(subscriber->subscriberContext,
+            subscriber->socketReconnectTimer = std::make_unique<asio::steady_timer>(subscriber->strand,
                                                                                     SOCKET_RECONNECT_WAIT_DURATION);
             pSubscriber->socketReconnectTimer->async_wait([pSubscriber, subscriber=std::move(subscriber)]
                                                           (const auto &error) mutable {
                 connect(std::move(subscriber));
             });
         } else {
+            transport::configure(subscriber->socket);
+
+            // Stay compatible with legacy publishers until a handshake is received
+            subscriber->protocolVersion = protocol::LEGACY_VERSION;
+            subscriber->handshakePending = true;
+            ++subscriber->connection;
+            std::error_code endpointError;
+            subscriber->connectionPort = transport::getPort(subscriber->socket.local_endpoint(endpointError));
+            subscriber->ackInterval = 1;
+            subscriber->unackedMsgs = 0;
+            subscriber->pendingCtrl.clear();
+            subscriber->sharedMemory.reset();
             receiveMsg(std::move(subscriber));
         }
     });
 }
 
+bool TcpSubscriber::connectIntraProcess(const std::shared_ptr<TcpSubscriber> &subscriber) {
+    auto channel = IntraProcessChannel::find(transport::getLocalName(subscriber->endpoint));
+    if (!channel) {
+        return false;
+    }
+
+    // Msgs are shared with the publisher instead of being copied
+    std::weak_ptr<TcpSubscriber> weakSubscriber(subscriber);
+    const auto subscriberId = channel->subscribe(subscriber->weakSubscriberContext, subscriber->strand,
+                              [weakSubscriber](auto msgTypeId, auto msg) {
+        auto subscriber = weakSubscriber.lock();
+        if (subscriber) {
+            auto pMsg = msg->data();
+            const auto msgSize = msg->size();
+            enqueueMsg(subscriber, toUnderlyingType(msgTypeId),
+                       MsgPtr(pMsg, MsgDeleter(std::move(msg))), msgSize, nullptr);
+        }
+    }, [weakSubscriber](auto msgTypeId) {
+        // Dropped on the publisher's thread while the subscriber is behind
+        auto subscriber = weakSubscriber.lock();
+        if (subscriber) {
+            std::lock_guard<std::mutex> lock(subscriber->statsMutex);
+            auto counters = subscriber->topicCounters.find(toUnderlyingType(msgTypeId));
+            if (counters != subscriber->topicCounters.cend()) {
+                counters->second->droppedMsgs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }, [weakSubscriber]{
+        // Fall back to whichever publisher takes over the endpoint
+        auto subscriber = weakSubscriber.lock();
+        if (subscriber) {
+            subscriber->intraProcessChannel.reset();
+            connect(std::move(subscriber));
+        }
+    });
+    if (!subscriberId) {
+        return false;
+    }
+
+    subscriber->intraProcessChannel = channel;
+    subscriber->intraProcessSubscriberId = subscriberId;
+    for (const auto msgTypeId : subscriber->subscribedMsgTypeIds) {
+        channel->subscribe(subscriberId, static_cast<MsgTypeId>(msgTypeId));
+    }
+    return true;
+}
+
+void TcpSubscriber::reconnect(std::shared_ptr<TcpSubscriber> &&subscriber) {
+    if (!subscriber->closed) {
+        subscriber->connectionCounters->reconnects.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Unmap the shared memory of the connection, once its msgs are released as well
+    std::error_code error;
+    subscriber->socket.close(error);
+    subscriber->sharedMemory.reset();
+    connect(std::move(subscriber));
+}
+
 void TcpSubscriber::receiveMsg(std::shared_ptr<TcpSubscriber> &&subscriber) {
     // Wait for msg header
-    auto msgHeader = std::make_unique<msgs::Header>();
-    auto pMsgHeader = msgHeader.get();
     auto pSubscriber = subscriber.get();
-    asio::async_read(pSubscriber->socket, asio::buffer(pMsgHeader, sizeof(msgs::Header)),
-                     [subscriber=std::move(subscriber), msgHeader=std::move(msgHeader), pMsgHeader]
+    asio::async_read(pSubscriber->socket, asio::buffer(&pSubscriber->msgHeader, sizeof(msgs::Header)),
+                     bindHandlerMemory(pSubscriber->handlerMemory, [subscriber=std::move(subscriber)]
+                     (const auto &error, auto) mutable {
+        if (error) {
+            reconnect(std::move(subscriber));
+            return;
+        }
+
+        receiveMsgData(std::move(subscriber));
+    }));
+}
+
+void TcpSubscriber::receiveMsgData(std::shared_ptr<TcpSubscriber> &&subscriber) {
+    // Receive msg along with its stamp
+    auto pSubscriber = subscriber.get();
+    const auto isStamped = pSubscriber->protocolVersion >= protocol::MSG_STAMP_VERSION &&
+            (pSubscriber->msgHeader.msg_type_id() & ~protocol::SHARED_MEMORY_MSG_FLAG) !=
+            toUnderlyingType(MsgTypeId::MSG_CTRL);
+    auto msg = pSubscriber->receiveBuffers->acquire(pSubscriber->msgHeader.msg_size());
+    const std::array<asio::mutable_buffer, 2> buffers{
+        asio::buffer(&pSubscriber->msgStamp, isStamped ? sizeof(msgs::MsgStamp) : 0),
+        asio::buffer(msg.get(), pSubscriber->msgHeader.msg_size())
+    };
+    asio::async_read(pSubscriber->socket, buffers,
+                     bindHandlerMemory(pSubscriber->handlerMemory,
+                                       [subscriber=std::move(subscriber), msg=std::move(msg), isStamped]
                      (const auto &error, auto bytesReceived) mutable {
-        try {
-            if (error) {
-                throw std::system_error(std::make_error_code(std::io_errc::stream));
-            }
+        if (error) {
+            reconnect(std::move(subscriber));
+            return;
+        }
 
-            // Receive the rest of the msg header
-            if (bytesReceived < sizeof(msgs::Header)) {
-                asio::read(subscriber->socket, asio::buffer(pMsgHeader + bytesReceived,
-                                                            sizeof(msgs::Header) - bytesReceived));
-            }
+        // Only the first msg of a connection may be a handshake
+        const auto msgTypeId = subscriber->msgHeader.msg_type_id();
+        const auto isHandshake = subscriber->handshakePending &&
+                msgTypeId == toUnderlyingType(MsgTypeId::MSG_CTRL) &&
+                subscriber->msgHeader.msg_size() == sizeof(msgs::Handshake);
+        subscriber->handshakePending = false;
+        if (isHandshake) {
+            acceptHandshake(std::move(subscriber), msg.get());
+            return;
+        }
+
+        // Control msgs are part of the protocol and not acknowledged
+        if (subscriber->protocolVersion >= protocol::WINDOWED_ACK_VERSION &&
+                msgTypeId == toUnderlyingType(MsgTypeId::MSG_CTRL)) {
+            acceptCtrlMsg(subscriber, msg.get());
+            receiveMsg(std::move(subscriber));
+            return;
+        }
 
-            // Receive msg
-            auto msg = std::make_unique<uint8_t[]>(msgHeader->msg_size());
-            asio::read(subscriber->socket, asio::buffer(msg.get(), msgHeader->msg_size()));
+        auto &counters = *subscriber->connectionCounters;
+        counters.msgs.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes.fetch_add(sizeof(msgs::Header) + bytesReceived, std::memory_order_relaxed);
 
-            // Enqueue msg for handling (only process latest msg)
-            const auto msgTypeId = msgHeader->msg_type_id();
-            if (!subscriber->msgBuffers[msgTypeId]) {
-                asio::post(subscriber->mainContext, [subscriber, msgTypeId]() mutable {
-                    postMsgHandlingTask(std::move(subscriber), msgTypeId);
-                });
+        auto msgSize = subscriber->msgHeader.msg_size();
+        MsgPtr receivedMsg(std::move(msg));
+        if (msgTypeId & protocol::SHARED_MEMORY_MSG_FLAG) {
+            receivedMsg = subscriber->receiveSharedMemoryMsg(receivedMsg.get(), msgSize);
+            if (!receivedMsg) {
+                reconnect(std::move(subscriber));
+                return;
             }
-            subscriber->msgBuffers[msgTypeId] = std::move(msg);
+        }
 
-            // Acknowledge msg reception
-            auto ack = msgs::MsgCtrl::ACK;
-            asio::write(subscriber->socket, asio::buffer(&ack, sizeof(msgs::MsgCtrl)));
+        enqueueMsg(subscriber, msgTypeId & ~protocol::SHARED_MEMORY_MSG_FLAG, std::move(receivedMsg), msgSize,
+                   isStamped ? &subscriber->msgStamp : nullptr);
+        acknowledgeMsg(std::move(subscriber));
+    }));
+}
 
-        } catch (...) {
-            subscriber->socket.close();
-            connect(std::move(subscriber));
-            return;
+void TcpSubscriber::acceptHandshake(std::shared_ptr<TcpSubscriber> &&subscriber,
+                                    const uint8_t msg[]) {
+    msgs::Handshake handshake;
+    std::copy(msg, msg + sizeof(msgs::Handshake), reinterpret_cast<uint8_t *>(&handshake));
+    subscriber->protocolVersion = std::min(handshake.version(), protocol::VERSION);
+    subscriber->ackInterval = std::max(handshake.window_size() / 2, 1u);
+
+    // The subscription follows the handshake reply
+    subscriber->queueCtrl(msgs::Ctrl(msgs::MsgCtrl::HANDSHAKE, subscriber->protocolVersion));
+    if (subscriber->protocolVersion >= protocol::SUBSCRIPTION_VERSION) {
+        subscriber->queueSubscription();
+    }
+    sendCtrl(subscriber);
+    receiveMsg(std::move(subscriber));
+}
+
+void TcpSubscriber::acceptCtrlMsg(const std::shared_ptr<TcpSubscriber> &subscriber,
+                                  const uint8_t msg[]) {
+    if (subscriber->msgHeader.msg_size() < sizeof(msgs::Ctrl)) {
+        return;
+    }
+
+    msgs::Ctrl ctrl;
+    std::memcpy(&ctrl, msg, sizeof(msgs::Ctrl));
+
+    if (ctrl.ctrl() == msgs::MsgCtrl::SHARED_MEMORY_SEGMENT) {
+        // Map the publisher's shared memory if it is on the same host
+        auto attached = false;
+        if (transport::isLocal(subscriber->endpoint) &&
+                ctrl.value() < SharedMemorySegment::MAX_SUBSCRIBER_HOLDERS) {
+            const std::string name(reinterpret_cast<const char *>(msg + sizeof(msgs::Ctrl)),
+                                   subscriber->msgHeader.msg_size() - sizeof(msgs::Ctrl));
+            try {
+                subscriber->sharedMemory = SharedMemorySegment::open(name, ctrl.value());
+                subscriber->sharedMemoryHolder = ctrl.value();
+                attached = true;
+            } catch (const std::system_error &) { }
         }
 
-        receiveMsg(std::move(subscriber));
+        subscriber->queueCtrl(msgs::Ctrl(msgs::MsgCtrl::SHARED_MEMORY_ATTACHED, attached));
+        sendCtrl(subscriber);
+    }
+}
+
+MsgPtr TcpSubscriber::receiveSharedMemoryMsg(const uint8_t msg[], uint32_t &msgSize) {
+    if (!this->sharedMemory || this->msgHeader.msg_size() != sizeof(msgs::SharedMemorySlot)) {
+        return nullptr;
+    }
+
+    msgs::SharedMemorySlot slotMsg;
+    std::memcpy(&slotMsg, msg, sizeof(msgs::SharedMemorySlot));
+    if (slotMsg.slot() >= this->sharedMemory->getSlotCount() ||
+            slotMsg.msg_size() > this->sharedMemory->getSlotSize()) {
+        return nullptr;
+    }
+
+    // The slot is held for the subscriber until the msg is released
+    msgSize = slotMsg.msg_size();
+    auto pMsg = this->sharedMemory->getSlotData(slotMsg.slot());
+    std::shared_ptr<const void> owner(pMsg, [sharedMemory=this->sharedMemory, slot=slotMsg.slot(),
+                                             holder=this->sharedMemoryHolder](const void *) {
+        sharedMemory->release(slot, holder);
     });
+    return MsgPtr(pMsg, MsgDeleter(std::move(owner)));
 }
 
-void TcpSubscriber::postMsgHandlingTask(std::shared_ptr<TcpSubscriber> &&subscriber,
-                                        MsgTypeIdUnderlyingType msgTypeId) {
+void TcpSubscriber::acknowledgeMsg(std::shared_ptr<TcpSubscriber> &&subscriber) {
     auto pSubscriber = subscriber.get();
-    asio::post(pSubscriber->subscriberContext,
-               [pSubscriber, subscriber=std::move(subscriber), msgTypeId]() mutable {
-        asio::post(pSubscriber->mainContext,
-                   [subscriber=std::move(subscriber), msgTypeId,
-                   msg=std::move(pSubscriber->msgBuffers[msgTypeId])]() mutable {
-            auto handler = subscriber->msgHandlers.find(msgTypeId);
-            if (handler != subscriber->msgHandlers.end()) {
-                handler->second(std::move(msg));
+
+    if (pSubscriber->protocolVersion < protocol::WINDOWED_ACK_VERSION) {
+        // The publisher waits for the ack before sending the next msg
+        pSubscriber->ctrl = msgs::Ctrl(msgs::MsgCtrl::ACK, 0);
+        asio::async_write(pSubscriber->socket, asio::buffer(&pSubscriber->ctrl, sizeof(msgs::MsgCtrl)),
+                          bindHandlerMemory(pSubscriber->handlerMemory, [subscriber=std::move(subscriber)]
+                     (const auto &error, auto) mutable {
+            if (error) {
+                reconnect(std::move(subscriber));
+                return;
             }
-        });
-    });
+
+            receiveMsg(std::move(subscriber));
+        }));
+        return;
+    }
+
+    // Acks are sent alongside receiving the next msgs
+    ++pSubscriber->unackedMsgs;
+    sendCtrl(subscriber);
+    receiveMsg(std::move(subscriber));
+}
+
+void TcpSubscriber::queueCtrl(const msgs::Ctrl &ctrl) {
+    auto pCtrl = reinterpret_cast<const uint8_t *>(&ctrl);
+    this->pendingCtrl.insert(this->pendingCtrl.end(), pCtrl, pCtrl + sizeof(msgs::Ctrl));
+}
+
+void TcpSubscriber::queueSubscription() {
+    this->queueCtrl(msgs::Ctrl(msgs::MsgCtrl::SUBSCRIBE, this->subscribedMsgTypeIds.size()));
+    for (const auto msgTypeId : this->subscribedMsgTypeIds) {
+        const uint32_t id = msgTypeId;
+        auto pId = reinterpret_cast<const uint8_t *>(&id);
+        this->pendingCtrl.insert(this->pendingCtrl.end(), pId, pId + sizeof(uint32_t));
+    }
+}
+
+void TcpSubscriber::sendCtrl(std::shared_ptr<TcpSubscriber> subscriber) {
+    if (subscriber->sendingCtrl) {
+        return;
+    }
+
+    // Coalesce acks while more msgs are already waiting to be received, unless other
+    // ctrl msgs have to be sent anyway
+    std::error_code error;
+    if (subscriber->unackedMsgs > 0 &&
+            (!subscriber->pendingCtrl.empty() ||
+             subscriber->unackedMsgs >= subscriber->ackInterval ||
+             subscriber->socket.available(error) == 0)) {
+        subscriber->queueCtrl(msgs::Ctrl(msgs::MsgCtrl::ACK_CUMULATIVE, subscriber->unackedMsgs));
+        subscriber->unackedMsgs = 0;
+    }
+
+    if (subscriber->pendingCtrl.empty()) {
+        return;
+    }
+
+    auto pSubscriber = subscriber.get();
+    std::swap(pSubscriber->pendingCtrl, pSubscriber->sendingCtrlBuffer);
+    pSubscriber->sendingCtrl = true;
+    pSubscriber->sendStartTime = protocol::getPublishTime();
+    asio::async_write(pSubscriber->socket, asio::buffer(pSubscriber->sendingCtrlBuffer),
+                      bindHandlerMemory(pSubscriber->handlerMemory, [subscriber=std::move(subscriber)]
+                     (const auto &error, auto) mutable {
+        // Connection errors are handled by the receiving side
+        const auto sendTime = protocol::getPublishTime() - subscriber->sendStartTime;
+        subscriber->connectionCounters->sendTime.fetch_add(sendTime, std::memory_order_relaxed);
+        subscriber->sendingCtrlBuffer.clear();
+        subscriber->sendingCtrl = false;
+        if (!error) {
+            sendCtrl(std::move(subscriber));
+        }
+    }));
+}
+
+void TcpSubscriber::enqueueMsg(const std::shared_ptr<TcpSubscriber> &subscriber,
+                               MsgTypeIdUnderlyingType msgTypeId, MsgPtr &&msg, size_t msgSize,
+                               const msgs::MsgStamp *msgStamp) {
+    auto subscription = subscriber->subscriptions.find(msgTypeId);
+    if (!subscription) {
+        return;
+    }
+
+    auto &counters = *subscription->getCounters();
+    counters.msgs.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(msgSize, std::memory_order_relaxed);
+
+    if (msgStamp) {
+        subscription->getStats()->recordSequence(subscriber->connection, msgStamp->sequence());
+    }
+
+    // Hand the msg off for handling, keeping as many msgs as the QoS of the msg type allows
+    const auto result = subscription->push(std::move(msg), msgSize, msgStamp, subscriber->connectionPort);
+    if (result != Subscription::Result::QUEUED) {
+        auto &lostMsgs = result == Subscription::Result::OVERWRITTEN ?
+                counters.overwrittenMsgs : counters.droppedMsgs;
+        lostMsgs.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 } // namespace ntwk
@@ -1,5 +1,13 @@
 #include <network/Thread.h>
 
+#include <string>
+#include <system_error>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace ntwk {
 
 Thread::Thread(ContextPtr context) : context(std::move(context)),
@@ -17,4 +25,24 @@ void Thread::stop() {
     this->context->stop();
 }
 
+void Thread::setCpuAffinity(unsigned int cpu) {
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                "CPU " + std::to_string(cpu) + " is out of range");
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    const auto error = pthread_setaffinity_np(this->t.native_handle(), sizeof(cpu_set_t), &cpus);
+    if (error) {
+        throw std::system_error(error, std::system_category(), "Failed to set thread CPU affinity");
+    }
+#else
+    throw std::system_error(std::make_error_code(std::errc::operation_not_supported),
+                            "Thread CPU affinity is not supported");
+#endif
+}
+
 } // namespace ntwk
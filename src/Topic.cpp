@@ -0,0 +1,45 @@
+#include <network/Topic.h>
+
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+#include <network/Utils.h>
+
+namespace {
+
+struct RegisteredTopic {
+    std::string name;
+    std::string msgTableName;
+};
+
+std::mutex registryMutex;
+std::unordered_map<uint32_t, RegisteredTopic> registry;
+
+} // namespace
+
+namespace ntwk {
+
+void registerTopic(const Topic &topic, const char *msgTableName) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto &registered = registry.emplace(toUnderlyingType(topic.getId()),
+                                        RegisteredTopic{topic.getName(), std::string()}).first->second;
+    if (registered.name != topic.getName()) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                "Topic " + std::string(topic.getName()) + " has the same id as " + registered.name);
+    }
+
+    if (!msgTableName) {
+        return;
+    }
+    if (registered.msgTableName.empty()) {
+        registered.msgTableName = msgTableName;
+    } else if (registered.msgTableName != msgTableName) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                "Topic " + registered.name + " carries " + registered.msgTableName +
+                                " msgs, not " + msgTableName);
+    }
+}
+
+} // namespace ntwk
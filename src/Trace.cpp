@@ -0,0 +1,188 @@
+#include <network/Trace.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+#include <network/Utils.h>
+
+#include "HandoffQueue.h"
+#include "TraceRecorder.h"
+
+#ifdef NETWORK_TRACING
+
+namespace {
+
+using ntwk::trace::Event;
+using ntwk::trace::Stage;
+
+// Events kept by a thread until they are written, about 3 MB
+constexpr size_t MAX_EVENTS_PER_THREAD = 64 * 1024;
+
+// Events of a thread, pushed by the thread and popped by whoever writes the trace
+struct ThreadBuffer {
+    const unsigned int thread;
+    ntwk::HandoffQueue<Event> events;
+    std::atomic<uint64_t> droppedEvents{0};
+    std::atomic<bool> exited{false};
+
+    explicit ThreadBuffer(unsigned int thread) : thread(thread), events(MAX_EVENTS_PER_THREAD) { }
+};
+
+// Buffers are registered once per thread and outlive their thread until their events are written
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+unsigned int threadCount = 0;
+
+struct ThreadTrace {
+    std::shared_ptr<ThreadBuffer> buffer;
+
+    ThreadTrace() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        this->buffer = std::make_shared<ThreadBuffer>(++threadCount);
+        registry.push_back(this->buffer);
+    }
+
+    ~ThreadTrace() {
+        this->buffer->exited.store(true);
+    }
+};
+
+thread_local ThreadTrace threadTrace;
+
+const char *getName(Stage stage) {
+    switch (stage) {
+    case Stage::ENCODE:
+        return "encode";
+    case Stage::DECODE:
+        return "decode";
+    case Stage::PUBLISH:
+        return "publish";
+    case Stage::QUEUE:
+        return "queue";
+    case Stage::WRITE:
+        return "write";
+    case Stage::ACK:
+        return "ack";
+    case Stage::DISPATCH:
+        return "dispatch";
+    case Stage::HANDLE:
+        return "handle";
+    }
+    return "";
+}
+
+// Waits between threads are async slices on the track of their msg. Without a sequence number
+// the msg has no track and the wait is shown on the thread that ended it.
+bool isAsync(const Event &event) {
+    return event.sequence != ntwk::trace::NO_SEQUENCE &&
+            event.stage != Stage::ENCODE && event.stage != Stage::DECODE && event.stage != Stage::HANDLE;
+}
+
+// Trace event times are in microseconds, written with the stream filled with zeros
+void writeTime(std::ostream &stream, uint64_t time) {
+    stream << time / 1000 << '.' << std::setw(3) << time % 1000;
+}
+
+void writeEvent(std::ostream &stream, const Event &event, const char *phase, uint64_t time,
+                unsigned int thread, int pid) {
+    stream << "{\"name\":\"" << getName(event.stage) << "\",\"cat\":\"network\",\"ph\":\"" << phase
+           << "\",\"pid\":" << pid << ",\"tid\":" << thread << ",\"ts\":";
+    writeTime(stream, time);
+    if (*phase == 'X') {
+        stream << ",\"dur\":";
+        writeTime(stream, event.end - event.start);
+    } else {
+        // Msg type ids, sequence numbers and connections identify msgs across processes. Only
+        // the low bits of sequence numbers are kept, which repeat long after a msg's slices end.
+        stream << ",\"id2\":{\"global\":\"0x" << std::hex
+               << ((uint64_t(ntwk::toUnderlyingType(event.msgTypeId)) << 32) | ((event.sequence & 0xffff) << 16) |
+                   event.connection)
+               << std::dec << "\"}";
+    }
+
+    if (event.hasMsgTypeId) {
+        stream << ",\"args\":{\"msg_type_id\":" << ntwk::toUnderlyingType(event.msgTypeId);
+        if (event.sequence != ntwk::trace::NO_SEQUENCE) {
+            stream << ",\"sequence\":" << event.sequence;
+        }
+        if (event.connection) {
+            stream << ",\"connection\":" << event.connection;
+        }
+        stream << '}';
+    }
+    stream << '}';
+}
+
+} // namespace
+
+#endif
+
+namespace ntwk {
+namespace trace {
+
+#ifdef NETWORK_TRACING
+
+void record(const Event &event) {
+    auto &buffer = *threadTrace.buffer;
+    auto recordedEvent = event;
+    if (!buffer.events.push(std::move(recordedEvent))) {
+        buffer.droppedEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool isEnabled() {
+    return true;
+}
+
+void writeChromeTrace(std::ostream &stream) {
+    const auto pid = static_cast<int>(getpid());
+    const auto fill = stream.fill('0');
+    uint64_t droppedEvents = 0;
+    auto separator = "";
+
+    stream << "{\"traceEvents\":[";
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto buffer = registry.begin(); buffer != registry.end();) {
+        // Check first whether the thread exited, so none of its events are left behind
+        const auto exited = (*buffer)->exited.load();
+        Event event;
+        while ((*buffer)->events.pop(event)) {
+            stream << separator;
+            separator = ",\n";
+            if (isAsync(event)) {
+                writeEvent(stream, event, "b", event.start, (*buffer)->thread, pid);
+                stream << ",\n";
+                writeEvent(stream, event, "e", event.end, (*buffer)->thread, pid);
+            } else {
+                writeEvent(stream, event, "X", event.start, (*buffer)->thread, pid);
+            }
+        }
+        droppedEvents += (*buffer)->droppedEvents.exchange(0, std::memory_order_relaxed);
+
+        buffer = exited ? registry.erase(buffer) : buffer + 1;
+    }
+    stream << "],\"otherData\":{\"dropped_events\":\"" << droppedEvents << "\"}}\n";
+    stream.fill(fill);
+}
+
+#else
+
+bool isEnabled() {
+    return false;
+}
+
+void writeChromeTrace(std::ostream &stream) {
+    stream << "{\"traceEvents\":[]}\n";
+}
+
+#endif
+
+} // namespace trace
+} // namespace ntwk
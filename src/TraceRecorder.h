@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+
+#include <network/MsgTypeId.h>
+
+#include "Protocol.h"
+
+namespace ntwk {
+namespace trace {
+
+// Stages of the lifecycle of a msg. The waits of a msg between threads are traced on the track
+// of the msg, the work done on a thread on the track of the thread.
+enum class Stage : uint8_t {
+    ENCODE,     // Compressing an image
+    DECODE,     // Decompressing an image
+    PUBLISH,    // From publishing a msg until it is handed to the sockets of its subscribers
+    QUEUE,      // Waiting in a socket's queue of the publisher
+    WRITE,      // Written to a socket, along with the msgs gathered into the same write
+    ACK,        // From the start of its write until the subscriber acknowledged it
+    DISPATCH,   // From being received until its handler is called
+    HANDLE      // Msg handler
+};
+
+constexpr uint64_t NO_SEQUENCE = UINT64_MAX;
+
+// A msg written to several sockets is traced once for each connection, which is told apart by
+// the port of the subscriber's socket as both ends know it. Connections over Unix domain
+// sockets have no port and share connection 0.
+struct Event {
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint64_t sequence = NO_SEQUENCE;
+    MsgTypeId msgTypeId{};
+    uint16_t connection = 0;
+    Stage stage = Stage::HANDLE;
+    bool hasMsgTypeId = false;
+};
+
+// Times share the clock of the msg stamps, which is the same for all processes on a host
+inline uint64_t now() {
+    return protocol::getPublishTime();
+}
+
+#ifdef NETWORK_TRACING
+
+// Appends the event to the calling thread's buffer without locking, or drops it while the
+// buffer is full
+void record(const Event &event);
+
+inline void record(Stage stage, uint64_t start, uint64_t end, MsgTypeId msgTypeId,
+                   uint64_t sequence=NO_SEQUENCE, uint16_t connection=0) {
+    Event event;
+    event.start = start;
+    event.end = end;
+    event.sequence = sequence;
+    event.msgTypeId = msgTypeId;
+    event.connection = connection;
+    event.stage = stage;
+    event.hasMsgTypeId = true;
+    record(event);
+}
+
+// Records a stage from its construction to its destruction
+class Scope {
+public:
+    explicit Scope(Stage stage) {
+        this->event.stage = stage;
+        this->event.start = now();
+    }
+
+    Scope(Stage stage, MsgTypeId msgTypeId, uint64_t sequence) : Scope(stage) {
+        this->event.msgTypeId = msgTypeId;
+        this->event.sequence = sequence;
+        this->event.hasMsgTypeId = true;
+    }
+
+    Scope(const Scope &other) = delete;
+    Scope &operator=(const Scope &other) = delete;
+
+    ~Scope() {
+        this->event.end = now();
+        record(this->event);
+    }
+
+private:
+    Event event;
+};
+
+#endif
+
+} // namespace trace
+} // namespace ntwk
@@ -0,0 +1,194 @@
+#include <network/Transport.h>
+
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <asio/ip/tcp.hpp>
+#include <asio/local/stream_protocol.hpp>
+
+#include <ifaddrs.h>
+#include <netinet/in.h>
+
+namespace {
+
+const std::string TCP_SCHEME = "tcp://";
+const std::string UDP_SCHEME = "udp://";
+const std::string UNIX_SCHEME = "unix://";
+
+bool startsWith(const std::string &s, const std::string &prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Split "host:port" (with IPv6 hosts in brackets) of the uri
+std::pair<asio::ip::address, unsigned short> parseAddress(const std::string &uri,
+                                                          const std::string &address) {
+    const auto separator = address.rfind(':');
+    if (separator == std::string::npos || separator + 1 == address.size()) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                "Missing port in endpoint " + uri);
+    }
+
+    auto host = address.substr(0, separator);
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    unsigned long port;
+    try {
+        port = std::stoul(address.substr(separator + 1));
+    } catch (const std::exception &) {
+        port = 0x10000;
+    }
+    if (port > 0xffff) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                "Invalid port in endpoint " + uri);
+    }
+
+    return {asio::ip::make_address(host), static_cast<unsigned short>(port)};
+}
+
+bool isUnix(const ntwk::transport::Endpoint &endpoint) {
+    return endpoint.protocol().family() == AF_UNIX;
+}
+
+asio::ip::tcp::endpoint toTcp(const ntwk::transport::Endpoint &endpoint) {
+    asio::ip::tcp::endpoint tcpEndpoint;
+    std::memcpy(tcpEndpoint.data(), endpoint.data(), endpoint.size());
+    tcpEndpoint.resize(endpoint.size());
+    return tcpEndpoint;
+}
+
+// Whether the address is assigned to one of the host's interfaces
+bool isHostAddress(const asio::ip::address &address) {
+    ifaddrs *interfaces = nullptr;
+    if (getifaddrs(&interfaces) != 0) {
+        return false;
+    }
+
+    auto found = false;
+    for (auto i = interfaces; i && !found; i = i->ifa_next) {
+        if (!i->ifa_addr) {
+            continue;
+        }
+
+        if (i->ifa_addr->sa_family == AF_INET && address.is_v4()) {
+            const auto &ipv4 = reinterpret_cast<const sockaddr_in *>(i->ifa_addr)->sin_addr;
+            found = address.to_v4().to_uint() == ntohl(ipv4.s_addr);
+        } else if (i->ifa_addr->sa_family == AF_INET6 && address.is_v6()) {
+            const auto &ipv6 = reinterpret_cast<const sockaddr_in6 *>(i->ifa_addr)->sin6_addr;
+            found = std::memcmp(address.to_v6().to_bytes().data(), ipv6.s6_addr, sizeof(ipv6.s6_addr)) == 0;
+        }
+    }
+    freeifaddrs(interfaces);
+    return found;
+}
+
+std::string getUnixPath(const ntwk::transport::Endpoint &endpoint) {
+    asio::local::stream_protocol::endpoint unixEndpoint;
+    std::memcpy(unixEndpoint.data(), endpoint.data(), endpoint.size());
+    unixEndpoint.resize(endpoint.size());
+    return unixEndpoint.path();
+}
+
+} // namespace
+
+namespace ntwk {
+namespace transport {
+
+Endpoint makeEndpoint(const std::string &uri) {
+    if (startsWith(uri, UNIX_SCHEME)) {
+        return asio::local::stream_protocol::endpoint(uri.substr(UNIX_SCHEME.size()));
+    }
+
+    const auto address = parseAddress(uri, startsWith(uri, TCP_SCHEME) ?
+                                               uri.substr(TCP_SCHEME.size()) : uri);
+    return asio::ip::tcp::endpoint(address.first, address.second);
+}
+
+bool isMulticast(const std::string &uri) {
+    return startsWith(uri, UDP_SCHEME);
+}
+
+asio::ip::udp::endpoint makeMulticastEndpoint(const std::string &uri) {
+    if (!isMulticast(uri)) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                "Not a multicast endpoint " + uri);
+    }
+
+    const auto address = parseAddress(uri, uri.substr(UDP_SCHEME.size()));
+    if (!address.first.is_multicast()) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                "Not a multicast group " + uri);
+    }
+    return asio::ip::udp::endpoint(address.first, address.second);
+}
+
+std::string makeUri(const std::string &host, unsigned short port) {
+    const auto isIpv6 = host.find(':') != std::string::npos;
+    return TCP_SCHEME + (isIpv6 ? "[" + host + "]" : host) + ":" + std::to_string(port);
+}
+
+bool isLocal(const Endpoint &endpoint) {
+    if (isUnix(endpoint)) {
+        return true;
+    }
+
+    auto address = toTcp(endpoint).address();
+    if (address.is_v6() && address.to_v6().is_v4_mapped()) {
+        address = asio::ip::make_address_v4(asio::ip::v4_mapped, address.to_v6());
+    }
+    return address.is_loopback() || isHostAddress(address);
+}
+
+unsigned short getPort(const Endpoint &endpoint) {
+    return isUnix(endpoint) ? 0 : toTcp(endpoint).port();
+}
+
+std::string getUri(const Endpoint &endpoint) {
+    if (isUnix(endpoint)) {
+        const auto path = getUnixPath(endpoint);
+        return path.empty() ? std::string() : UNIX_SCHEME + path;
+    }
+
+    const auto tcpEndpoint = toTcp(endpoint);
+    return makeUri(tcpEndpoint.address().to_string(), tcpEndpoint.port());
+}
+
+std::string getLocalName(const Endpoint &endpoint) {
+    if (isUnix(endpoint)) {
+        return UNIX_SCHEME + getUnixPath(endpoint);
+    }
+    return TCP_SCHEME + std::to_string(toTcp(endpoint).port());
+}
+
+Acceptor makeAcceptor(const Strand &strand, const Endpoint &endpoint) {
+    // Replace a socket file left behind by a publisher that is no longer running
+    if (isUnix(endpoint)) {
+        Socket socket(strand);
+        std::error_code error;
+        socket.connect(endpoint, error);
+        if (error == asio::error::connection_refused) {
+            remove(endpoint);
+        }
+    }
+    return Acceptor(strand, endpoint);
+}
+
+void configure(Socket &socket) {
+    std::error_code error;
+    const auto endpoint = socket.local_endpoint(error);
+    if (!error && !isUnix(endpoint)) {
+        socket.set_option(asio::ip::tcp::no_delay(true), error);
+    }
+}
+
+void remove(const Endpoint &endpoint) {
+    if (isUnix(endpoint)) {
+        std::remove(getUnixPath(endpoint).c_str());
+    }
+}
+
+} // namespace transport
+} // namespace ntwk
@@ -0,0 +1,156 @@
+#include <network/UdpPublisher.h>
+
+#include <algorithm>
+#include <array>
+
+#include <asio/ip/multicast.hpp>
+
+#include <network/Transport.h>
+#include <network/Utils.h>
+
+#include "Protocol.h"
+
+namespace {
+
+constexpr unsigned int MAX_FRAGMENTS_PER_SEND = 64;
+
+using MsgQueueResult = ntwk::MsgQueue<std::shared_ptr<flatbuffers::DetachedBuffer>>::Result;
+
+} // namespace
+
+namespace ntwk {
+
+std::shared_ptr<UdpPublisher> UdpPublisher::create(asio::io_context &publisherContext,
+                                                   const std::string &endpoint) {
+    return std::shared_ptr<UdpPublisher>(new UdpPublisher(publisherContext, endpoint));
+}
+
+UdpPublisher::UdpPublisher(asio::io_context &publisherContext, const std::string &endpoint) :
+    strand(asio::make_strand(publisherContext)),
+    endpoint(transport::makeMulticastEndpoint(endpoint)),
+    socket(this->strand, this->endpoint.protocol()),
+    sending(false), sequence(0) {
+    // Subscribers on the same host receive the msgs through the loopback
+    this->socket.set_option(asio::ip::multicast::enable_loopback(true));
+    this->socket.set_option(asio::ip::multicast::hops(1));
+    this->socket.non_blocking(true);
+}
+
+void UdpPublisher::publish(MsgTypeId msgTypeId,
+                           std::shared_ptr<flatbuffers::DetachedBuffer> msg) {
+    asio::post(this->strand,
+               [publisher=this->shared_from_this(), msgTypeId, msg=std::move(msg)]() mutable {
+        // Schedule msg to be sent unless it took the place of an older msg. Msgs too large for
+        // subscribers to reassemble are dropped.
+        const auto msgSize = msg->size();
+        const auto result = msgSize > protocol::MULTICAST_MAX_MSG_SIZE ? MsgQueueResult::DROPPED :
+                publisher->msgs[msgTypeId].push(std::move(msg), msgSize);
+        if (result == MsgQueueResult::QUEUED) {
+            publisher->pendingMsgTypeIds.push_back(msgTypeId);
+        } else {
+            std::lock_guard<std::mutex> lock(publisher->queueStatsMutex);
+            auto &stats = publisher->queueStats[msgTypeId];
+            ++(result == MsgQueueResult::OVERWRITTEN ? stats.overwrittenMsgs : stats.droppedMsgs);
+        }
+
+        if (!publisher->sending) {
+            publisher->sending = true;
+            sendMsg(std::move(publisher));
+        }
+    });
+}
+
+void UdpPublisher::setQoS(MsgTypeId msgTypeId, const QoS &qos) {
+    asio::post(this->strand, [publisher=this->shared_from_this(), msgTypeId, qos] {
+        publisher->msgs[msgTypeId].setQoS(qos);
+    });
+}
+
+QueueStats UdpPublisher::getQueueStats(MsgTypeId msgTypeId) const {
+    std::lock_guard<std::mutex> lock(this->queueStatsMutex);
+    auto stats = this->queueStats.find(msgTypeId);
+    return stats != this->queueStats.cend() ? stats->second : QueueStats();
+}
+
+std::future<void> UdpPublisher::close() {
+    auto closed = std::make_shared<std::promise<void>>();
+    auto future = closed->get_future();
+    asio::post(this->strand, [publisher=this->shared_from_this(), closed] {
+        std::error_code error;
+        publisher->socket.close(error);
+        publisher->msgs.clear();
+        publisher->pendingMsgTypeIds.clear();
+        publisher->sendingMsg.reset();
+        closed->set_value();
+    });
+    return future;
+}
+
+void UdpPublisher::sendMsg(PublisherPtr &&publisher) {
+    auto pPublisher = publisher.get();
+
+    for (unsigned int fragments = 0; fragments < MAX_FRAGMENTS_PER_SEND; ++fragments) {
+        // Take ownership of the next pending msg so a newer msg of the same type can be enqueued
+        if (!pPublisher->sendingMsg) {
+            if (pPublisher->pendingMsgTypeIds.empty()) {
+                pPublisher->sending = false;
+                return;
+            }
+
+            // Msgs may have been discarded when the QoS was lowered
+            const auto msgTypeId = pPublisher->pendingMsgTypeIds.front();
+            pPublisher->pendingMsgTypeIds.pop_front();
+            auto &msgQueue = pPublisher->msgs[msgTypeId];
+            if (msgQueue.empty()) {
+                continue;
+            }
+            pPublisher->sendingMsg = msgQueue.pop();
+
+            pPublisher->fragment = msgs::MulticastFragment(toUnderlyingType(msgTypeId),
+                                                           pPublisher->sequence++,
+                                                           pPublisher->sendingMsg->size(), 0);
+        }
+
+        // Send the next fragment of the msg
+        const auto &fragment = pPublisher->fragment;
+        const auto fragmentSize = std::min(protocol::MULTICAST_FRAGMENT_SIZE,
+                                           pPublisher->sendingMsg->size() - fragment.offset());
+        const std::array<asio::const_buffer, 2> buffers {{
+            asio::buffer(&fragment, sizeof(msgs::MulticastFragment)),
+            asio::buffer(pPublisher->sendingMsg->data() + fragment.offset(), fragmentSize)
+        }};
+
+        std::error_code error;
+        pPublisher->socket.send_to(buffers, pPublisher->endpoint, 0, error);
+        if (error == asio::error::would_block) {
+            pPublisher->socket.async_wait(asio::ip::udp::socket::wait_write,
+                                          bindHandlerMemory(pPublisher->handlerMemory,
+                                                            [publisher=std::move(publisher)]
+                                          (const auto &error) mutable {
+                if (error) {
+                    publisher->sending = false;
+                    return;
+                }
+                sendMsg(std::move(publisher));
+            }));
+            return;
+        }
+
+        // A failed send loses the msg, which subscribers detect from the sequence number
+        const auto offset = fragment.offset() + fragmentSize;
+        if (error || offset >= fragment.msg_size()) {
+            pPublisher->sendingMsg.reset();
+        } else {
+            pPublisher->fragment = msgs::MulticastFragment(fragment.msg_type_id(), fragment.sequence(),
+                                                           fragment.msg_size(), offset);
+        }
+    }
+
+    // Let other work on the publisher context run between bursts of fragments
+    asio::post(pPublisher->strand, bindHandlerMemory(pPublisher->handlerMemory,
+                                                     [publisher=std::move(publisher)]() mutable {
+        sendMsg(std::move(publisher));
+    }));
+}
+
+} // namespace ntwk
@@ -0,0 +1,213 @@
+#include <network/UdpSubscriber.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <asio/ip/multicast.hpp>
+
+#include <network/Transport.h>
+#include <network/Utils.h>
+
+#include "Protocol.h"
+#include "ReceiveBufferPool.h"
+#include "Subscription.h"
+
+namespace {
+
+// Buffer bursts of fragments while the subscriber thread is busy
+constexpr int SOCKET_RECEIVE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// Publishers beyond this many make room by forgetting another publisher's msg
+constexpr size_t MAX_PUBLISHERS = 64;
+
+} // namespace
+
+namespace ntwk {
+
+std::shared_ptr<UdpSubscriber> UdpSubscriber::create(const std::shared_ptr<asio::io_context> &mainContext,
+                                                     const std::shared_ptr<asio::io_context> &subscriberContext,
+                                                     const std::string &endpoint) {
+    std::shared_ptr<UdpSubscriber> subscriber(new UdpSubscriber(mainContext, subscriberContext,
+                                                                endpoint));
+    asio::post(subscriber->strand, [subscriber]() mutable {
+        receiveFragment(std::move(subscriber));
+    });
+    return subscriber;
+}
+
+UdpSubscriber::UdpSubscriber(const std::shared_ptr<asio::io_context> &mainContext,
+                             const std::shared_ptr<asio::io_context> &subscriberContext,
+                             const std::string &endpoint) :
+    mainContext(mainContext), strand(asio::make_strand(*subscriberContext)),
+    socket(this->strand), datagram(protocol::MULTICAST_MAX_DATAGRAM_SIZE),
+    receiveBuffers(std::make_shared<ReceiveBufferPool>()), lostMsgs(0) {
+    // Several subscribers on the same host share the multicast port
+    const auto group = transport::makeMulticastEndpoint(endpoint);
+    this->socket.open(group.protocol());
+    this->socket.set_option(asio::ip::udp::socket::reuse_address(true));
+    this->socket.bind(asio::ip::udp::endpoint(group.protocol(), group.port()));
+    this->socket.set_option(asio::ip::multicast::join_group(group.address()));
+
+    std::error_code error;
+    this->socket.set_option(asio::socket_base::receive_buffer_size(SOCKET_RECEIVE_BUFFER_SIZE), error);
+}
+
+void UdpSubscriber::subscribe(MsgTypeId msgTypeId, MsgHandler msgHandler, const QoS &qos,
+                              const Dispatch &dispatch) {
+    this->subscribe(msgTypeId, SizedMsgHandler([msgHandler=std::move(msgHandler)](MsgPtr &&msg, size_t) {
+        msgHandler(std::move(msg));
+    }), qos, dispatch);
+}
+
+void UdpSubscriber::subscribe(MsgTypeId msgTypeId, SizedMsgHandler msgHandler, const QoS &qos,
+                              const Dispatch &dispatch) {
+    auto subscription = std::make_shared<Subscription>(msgTypeId, this->mainContext, std::move(msgHandler),
+                                                       qos, dispatch);
+
+    asio::post(this->strand,
+               [subscriber=this->shared_from_this(), msgTypeId=toUnderlyingType(msgTypeId),
+                subscription=std::move(subscription)]() mutable {
+        subscriber->subscriptions.insert(msgTypeId, std::move(subscription));
+    });
+}
+
+QueueStats UdpSubscriber::getQueueStats(MsgTypeId msgTypeId) const {
+    std::lock_guard<std::mutex> lock(this->queueStatsMutex);
+    auto stats = this->queueStats.find(toUnderlyingType(msgTypeId));
+    return stats != this->queueStats.cend() ? stats->second : QueueStats();
+}
+
+uint64_t UdpSubscriber::getLostMsgCount() const {
+    return this->lostMsgs.load(std::memory_order_relaxed);
+}
+
+std::future<void> UdpSubscriber::close() {
+    auto closed = std::make_shared<std::promise<void>>();
+    auto future = closed->get_future();
+    asio::post(this->strand, [subscriber=this->shared_from_this(), closed] {
+        subscriber->subscriptions.clear();
+
+        std::error_code error;
+        subscriber->socket.close(error);
+        closed->set_value();
+    });
+    return future;
+}
+
+void UdpSubscriber::receiveFragment(std::shared_ptr<UdpSubscriber> &&subscriber) {
+    auto pSubscriber = subscriber.get();
+    pSubscriber->socket.async_receive_from(asio::buffer(pSubscriber->datagram), pSubscriber->datagramSender,
+                                           bindHandlerMemory(pSubscriber->handlerMemory,
+                                                             [subscriber=std::move(subscriber)]
+                                           (const auto &error, auto size) mutable {
+        if (error == asio::error::operation_aborted) {
+            return;
+        }
+
+        if (!error) {
+            msgs::MulticastFragment fragment;
+            auto msg = subscriber->acceptFragment(size, fragment);
+            if (msg) {
+                enqueueMsg(subscriber, fragment.msg_type_id(), std::move(msg), fragment.msg_size());
+            }
+        }
+
+        receiveFragment(std::move(subscriber));
+    }));
+}
+
+MsgPtr UdpSubscriber::acceptFragment(size_t datagramSize, msgs::MulticastFragment &fragment) {
+    // Ignore datagrams that are not fragments of a msg
+    if (datagramSize < sizeof(msgs::MulticastFragment)) {
+        return nullptr;
+    }
+
+    std::memcpy(&fragment, this->datagram.data(), sizeof(msgs::MulticastFragment));
+    const auto fragmentSize = datagramSize - sizeof(msgs::MulticastFragment);
+    if (fragment.msg_size() > protocol::MULTICAST_MAX_MSG_SIZE || fragment.offset() > fragment.msg_size() ||
+            fragmentSize > fragment.msg_size() - fragment.offset()) {
+        return nullptr;
+    }
+
+    auto reassembly = this->reassemblies.find(this->datagramSender);
+    if (reassembly == this->reassemblies.end()) {
+        if (this->reassemblies.size() >= MAX_PUBLISHERS) {
+            this->reassemblies.erase(this->reassemblies.begin());
+        }
+        reassembly = this->reassemblies.emplace(this->datagramSender, Reassembly()).first;
+    }
+    auto &r = reassembly->second;
+
+    const auto continuesMsg = r.msg &&
+            fragment.sequence() == r.fragment.sequence() &&
+            fragment.msg_type_id() == r.fragment.msg_type_id() &&
+            fragment.msg_size() == r.fragment.msg_size() &&
+            fragment.offset() == r.receivedSize;
+    if (!continuesMsg) {
+        // Rest of the msg being reassembled was lost
+        if (r.msg) {
+            r.msg.reset();
+            this->lostMsgs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Older sequence numbers are the remaining fragments of a lost msg, unless a new msg
+        // starts, which happens when the publisher restarts
+        const auto sequenceGap = static_cast<int32_t>(fragment.sequence() - r.nextSequence);
+        if (sequenceGap < 0 && fragment.offset() != 0) {
+            return nullptr;
+        }
+
+        if (r.receivedFirstMsg && sequenceGap > 0) {
+            this->lostMsgs.fetch_add(sequenceGap, std::memory_order_relaxed);
+        }
+        r.nextSequence = fragment.sequence() + 1;
+
+        // Start of the msg was lost
+        if (fragment.offset() != 0) {
+            if (r.receivedFirstMsg) {
+                this->lostMsgs.fetch_add(1, std::memory_order_relaxed);
+            }
+            r.receivedFirstMsg = true;
+            return nullptr;
+        }
+
+        r.receivedFirstMsg = true;
+        r.fragment = fragment;
+        r.msg = this->receiveBuffers->acquire(fragment.msg_size());
+        r.receivedSize = 0;
+    }
+
+    // The fragment has to fit the msg as it was allocated
+    if (fragmentSize > r.fragment.msg_size() - r.receivedSize) {
+        r.msg.reset();
+        this->lostMsgs.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    std::copy(this->datagram.data() + sizeof(msgs::MulticastFragment),
+              this->datagram.data() + datagramSize, r.msg.get() + r.receivedSize);
+    r.receivedSize += fragmentSize;
+
+    if (r.receivedSize < r.fragment.msg_size()) {
+        return nullptr;
+    }
+    return std::move(r.msg);
+}
+
+void UdpSubscriber::enqueueMsg(const std::shared_ptr<UdpSubscriber> &subscriber,
+                               MsgTypeIdUnderlyingType msgTypeId, MsgPtr &&msg, size_t msgSize) {
+    auto subscription = subscriber->subscriptions.find(msgTypeId);
+    if (!subscription) {
+        return;
+    }
+
+    // Hand the msg off for handling, keeping as many msgs as the QoS of the msg type allows
+    const auto result = subscription->push(std::move(msg), msgSize);
+    if (result != Subscription::Result::QUEUED) {
+        std::lock_guard<std::mutex> lock(subscriber->queueStatsMutex);
+        auto &stats = subscriber->queueStats[msgTypeId];
+        ++(result == Subscription::Result::OVERWRITTEN ? stats.overwrittenMsgs : stats.droppedMsgs);
+    }
+}
+
+} // namespace ntwk